@@ -0,0 +1,260 @@
+#include "mesh_optimizer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "glm/glm.hpp"
+
+// Cache modeled by the scores, larger than the measured one as in the paper: the order stays good on larger caches
+static constexpr std::size_t scoring_cache_size = 32;
+
+// Triangles of a cluster for the overdraw sort, clusters are cut where the vertex cache starts over anyway
+static constexpr std::size_t min_cluster_triangles = 64;
+static constexpr std::size_t max_cluster_triangles = 4 * min_cluster_triangles;
+
+static constexpr std::uint32_t no_triangle = std::numeric_limits<std::uint32_t>::max();
+static constexpr std::uint32_t no_vertex   = std::numeric_limits<std::uint32_t>::max();
+
+float compute_acmr(std::span<const std::uint32_t> indices, std::size_t cache_size)
+{
+    if (indices.size() < 3)
+        return 0.f;
+
+    std::vector<std::uint32_t> cache; // FIFO, newest at the back
+    std::size_t                misses = 0;
+    for (const std::uint32_t index : indices)
+    {
+        if (std::find(cache.begin(), cache.end(), index) != cache.end())
+            continue;
+        misses++;
+        cache.push_back(index);
+        if (cache.size() > cache_size)
+            cache.erase(cache.begin());
+    }
+    return static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+}
+
+static float vertex_score(int cache_position, std::uint32_t remaining_triangles)
+{
+    if (remaining_triangles == 0)
+        return -1.f;
+
+    float score = 0.f;
+    if (cache_position >= 0)
+    {
+        // The vertices of the last triangle get a fixed score, so that the next one does not always reuse its edge
+        if (cache_position < 3)
+            score = 0.75f;
+        else
+            score = std::pow(1.f - static_cast<float>(cache_position - 3) / static_cast<float>(scoring_cache_size - 3), 1.5f);
+    }
+    // Vertices with few triangles left are finished first, rather than left alone to be transformed again later
+    return score + 2.f / std::sqrt(static_cast<float>(remaining_triangles));
+}
+
+void optimize_vertex_cache(std::vector<std::uint32_t>& indices, std::size_t vertex_count)
+{
+    const std::size_t triangle_count = indices.size() / 3;
+    if (triangle_count == 0)
+        return;
+
+    // Triangles using each vertex, the first remaining[v] of its range are the ones not emitted yet
+    std::vector<std::uint32_t> first_triangle(vertex_count + 1, 0);
+    for (const std::uint32_t index : indices)
+    {
+        first_triangle[index + 1]++;
+    }
+    for (std::size_t v = 0; v < vertex_count; v++)
+    {
+        first_triangle[v + 1] += first_triangle[v];
+    }
+    std::vector<std::uint32_t> remaining(vertex_count, 0);
+    std::vector<std::uint32_t> adjacency(indices.size());
+    for (std::size_t t = 0; t < triangle_count; t++)
+    {
+        for (std::size_t corner = 0; corner < 3; corner++)
+        {
+            const std::uint32_t v                         = indices[3 * t + corner];
+            adjacency[first_triangle[v] + remaining[v]++] = static_cast<std::uint32_t>(t);
+        }
+    }
+
+    std::vector<int>   cache_position(vertex_count, -1);
+    std::vector<float> scores(vertex_count);
+    for (std::size_t v = 0; v < vertex_count; v++)
+    {
+        scores[v] = vertex_score(-1, remaining[v]);
+    }
+    std::vector<float> triangle_scores(triangle_count);
+    std::vector<bool>  emitted(triangle_count, false);
+    std::uint32_t      best = 0;
+    for (std::size_t t = 0; t < triangle_count; t++)
+    {
+        triangle_scores[t] = scores[indices[3 * t]] + scores[indices[3 * t + 1]] + scores[indices[3 * t + 2]];
+        if (triangle_scores[t] > triangle_scores[best])
+            best = static_cast<std::uint32_t>(t);
+    }
+
+    std::vector<std::uint32_t> output;
+    std::vector<std::uint32_t> cache;
+    std::vector<std::uint32_t> new_cache;
+    output.reserve(indices.size());
+    std::size_t next_unemitted = 0;
+    while (output.size() < indices.size())
+    {
+        if (best == no_triangle)
+        {
+            // Nothing left around the cache, the mesh continues in another part
+            while (emitted[next_unemitted])
+                next_unemitted++;
+            best = static_cast<std::uint32_t>(next_unemitted);
+        }
+        emitted[best] = true;
+        const std::uint32_t* triangle = &indices[3 * best];
+        output.insert(output.end(), triangle, triangle + 3);
+
+        new_cache.clear();
+        for (std::size_t corner = 0; corner < 3; corner++)
+        {
+            const std::uint32_t v     = triangle[corner];
+            std::uint32_t*      begin = &adjacency[first_triangle[v]];
+            std::uint32_t*      end   = begin + remaining[v];
+            std::swap(*std::find(begin, end, best), *(end - 1));
+            remaining[v]--;
+            if (std::find(new_cache.begin(), new_cache.end(), v) == new_cache.end())
+                new_cache.push_back(v);
+        }
+        const std::size_t triangle_vertices = new_cache.size(); // Fewer than 3 for degenerate triangles
+        for (const std::uint32_t v : cache)
+        {
+            if (std::find(new_cache.begin(), new_cache.begin() + static_cast<std::ptrdiff_t>(triangle_vertices), v) == new_cache.begin() + static_cast<std::ptrdiff_t>(triangle_vertices))
+                new_cache.push_back(v);
+        }
+
+        // Rescores the vertices that moved in the cache, or out of it, then the triangles around them
+        for (std::size_t position = 0; position < new_cache.size(); position++)
+        {
+            const std::uint32_t v = new_cache[position];
+            cache_position[v]     = position < scoring_cache_size ? static_cast<int>(position) : -1;
+            scores[v]             = vertex_score(cache_position[v], remaining[v]);
+        }
+        best             = no_triangle;
+        float best_score = -std::numeric_limits<float>::max();
+        for (const std::uint32_t v : new_cache)
+        {
+            for (std::uint32_t k = 0; k < remaining[v]; k++)
+            {
+                const std::uint32_t t = adjacency[first_triangle[v] + k];
+                triangle_scores[t]    = scores[indices[3 * t]] + scores[indices[3 * t + 1]] + scores[indices[3 * t + 2]];
+                if (triangle_scores[t] > best_score)
+                {
+                    best       = t;
+                    best_score = triangle_scores[t];
+                }
+            }
+        }
+        if (new_cache.size() > scoring_cache_size)
+            new_cache.resize(scoring_cache_size);
+        cache.swap(new_cache);
+    }
+    indices.swap(output);
+}
+
+void optimize_overdraw(std::vector<std::uint32_t>& indices, std::span<const float> vertices, std::size_t vertex_stride, float max_acmr_increase)
+{
+    const std::size_t triangle_count = indices.size() / 3;
+    if (triangle_count <= min_cluster_triangles)
+        return;
+
+    auto position = [&](std::uint32_t index) {
+        const float* vertex = &vertices[index * vertex_stride];
+        return glm::vec3(vertex[0], vertex[1], vertex[2]);
+    };
+
+    // Clusters keep the order of the vertex cache optimization inside them, they start where a triangle misses the
+    // cache for its 3 vertices, so that moving them around costs little
+    struct Cluster {
+        std::size_t first_triangle;
+        std::size_t triangle_count;
+        float       sort_key;
+    };
+    std::vector<Cluster>       clusters;
+    std::vector<std::uint32_t> cache;
+    std::size_t                cluster_start = 0;
+    for (std::size_t t = 0; t < triangle_count; t++)
+    {
+        int misses = 0;
+        for (std::size_t corner = 0; corner < 3; corner++)
+        {
+            const std::uint32_t index = indices[3 * t + corner];
+            if (std::find(cache.begin(), cache.end(), index) != cache.end())
+                continue;
+            misses++;
+            cache.push_back(index);
+            if (cache.size() > vertex_cache_size)
+                cache.erase(cache.begin());
+        }
+        const std::size_t size = t - cluster_start;
+        if ((size >= min_cluster_triangles && misses == 3) || size >= max_cluster_triangles)
+        {
+            clusters.push_back({cluster_start, size, 0.f});
+            cluster_start = t;
+        }
+    }
+    clusters.push_back({cluster_start, triangle_count - cluster_start, 0.f});
+
+    glm::vec3 mesh_center(0.f);
+    for (const std::uint32_t index : indices)
+    {
+        mesh_center += position(index);
+    }
+    mesh_center /= static_cast<float>(indices.size());
+
+    // Clusters far out in the direction they face are in front of the others from most points of view
+    for (Cluster& cluster : clusters)
+    {
+        glm::vec3 center(0.f);
+        glm::vec3 normal(0.f); // Weighted by the area of the triangles
+        for (std::size_t t = cluster.first_triangle; t < cluster.first_triangle + cluster.triangle_count; t++)
+        {
+            const glm::vec3 a = position(indices[3 * t]);
+            const glm::vec3 b = position(indices[3 * t + 1]);
+            const glm::vec3 c = position(indices[3 * t + 2]);
+            center += a + b + c;
+            normal += glm::cross(b - a, c - a);
+        }
+        center /= static_cast<float>(3 * cluster.triangle_count);
+        const float length = glm::length(normal);
+        cluster.sort_key   = length > 0.f ? glm::dot(center - mesh_center, normal / length) : 0.f;
+    }
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.sort_key > b.sort_key; });
+
+    std::vector<std::uint32_t> sorted;
+    sorted.reserve(indices.size());
+    for (const Cluster& cluster : clusters)
+    {
+        sorted.insert(sorted.end(), indices.begin() + static_cast<std::ptrdiff_t>(3 * cluster.first_triangle),
+                      indices.begin() + static_cast<std::ptrdiff_t>(3 * (cluster.first_triangle + cluster.triangle_count)));
+    }
+    if (compute_acmr(sorted) <= compute_acmr(indices) * max_acmr_increase)
+        indices.swap(sorted);
+}
+
+void optimize_vertex_fetch(std::vector<float>& vertices, std::size_t vertex_stride, std::vector<std::uint32_t>& indices)
+{
+    const std::size_t          vertex_count = vertices.size() / vertex_stride;
+    std::vector<std::uint32_t> remap(vertex_count, no_vertex);
+    std::vector<float>         reordered(vertices.size());
+    std::uint32_t              next = 0;
+    for (std::uint32_t& index : indices)
+    {
+        if (remap[index] == no_vertex)
+        {
+            std::copy_n(vertices.begin() + static_cast<std::ptrdiff_t>(index * vertex_stride), vertex_stride, reordered.begin() + static_cast<std::ptrdiff_t>(next * vertex_stride));
+            remap[index] = next++;
+        }
+        index = remap[index];
+    }
+    // Vertices no triangle uses are dropped
+    reordered.resize(next * vertex_stride);
+    vertices.swap(reordered);
+}
@@ -0,0 +1,43 @@
+#include "mesh_report.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <vector>
+#include "model_loader.hpp"
+#include "vertex_packing.hpp"
+
+int print_mesh_report(const std::string& directory)
+{
+    std::error_code                    error;
+    std::vector<std::filesystem::path> paths;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+    {
+        if (entry.path().extension() == ".obj")
+            paths.push_back(entry.path());
+    }
+    if (error)
+    {
+        std::cerr << "Error: cannot list " << directory << ": " << error.message() << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::sort(paths.begin(), paths.end());
+
+    std::cout << "asset,format,vertices,unindexed_float_bytes,vertex_bytes,index_bytes,saved_percent,max_normal_error_degrees,max_uv_error\n";
+    for (const std::filesystem::path& path : paths)
+    {
+        const ModelLoader::Model model        = ModelLoader::load_model(path.string());
+        const PackedVertices     packed       = pack_vertices(model.combined_data);
+        const std::size_t        vertex_count = model.combined_data.size() / ModelLoader::vertex_stride;
+        const std::size_t        index_size   = vertex_count <= std::numeric_limits<std::uint16_t>::max() ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+
+        const std::size_t before = model.unindexed_vertex_count * ModelLoader::vertex_stride * sizeof(float);
+        const std::size_t after  = packed.data.size() + model.indices.size() * index_size;
+        std::cout << path.filename().string() << ',' << vertex_format_name(packed.format) << ',' << vertex_count << ',' << before << ','
+                  << packed.data.size() << ',' << model.indices.size() * index_size << ',' << 100. * (1. - static_cast<double>(after) / static_cast<double>(before)) << ','
+                  << packed.max_normal_error_degrees << ',' << packed.max_uv_error << '\n';
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <string>
+
+// Loads every OBJ of the directory as Model would and prints, as CSV, the memory of its vertices and indices in the
+// unindexed float layout it used to have, then in the indexed layout and vertex format chosen for it
+int print_mesh_report(const std::string& directory);
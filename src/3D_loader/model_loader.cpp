@@ -2,6 +2,27 @@
 
 #include "model_loader.hpp"
 #include <iostream>
+#include <unordered_map>
+#include "mesh_optimizer.hpp"
+
+// Corner of a face in the OBJ file, corners with the same indices are the same vertex
+struct CornerKey {
+    int vertex_index;
+    int normal_index;
+    int texcoord_index;
+
+    bool operator==(const CornerKey&) const = default;
+};
+
+struct CornerKeyHash {
+    std::size_t operator()(const CornerKey& key) const
+    {
+        std::size_t hash = static_cast<std::size_t>(key.vertex_index) * 0x9E3779B97F4A7C15ull;
+        hash ^= static_cast<std::size_t>(key.normal_index) + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2);
+        hash ^= static_cast<std::size_t>(key.texcoord_index) + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2);
+        return hash;
+    }
+};
 
 ModelLoader::Model ModelLoader::load_model(const std::string& file_path)
 {
@@ -35,7 +56,8 @@ ModelLoader::Model ModelLoader::load_model(const std::string& file_path)
 
 ModelLoader::Model ModelLoader::process_model(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes)
 {
-    Model model;
+    Model                                                       model;
+    std::unordered_map<CornerKey, std::uint32_t, CornerKeyHash> vertex_of_corner;
 
     // Loop over shapes
     for (const auto& shape : shapes)
@@ -49,11 +71,18 @@ ModelLoader::Model ModelLoader::process_model(const tinyobj::attrib_t& attrib, c
             // Loop over vertices in the face.
             for (size_t v = 0; v < fv; v++)
             {
-                // Access to vertex
+                // Access to vertex, only added the first time one of its faces uses it
                 const tinyobj::index_t& idx = shape.mesh.indices[index_offset + v];
-                const float             vx  = attrib.vertices[3 * idx.vertex_index + 0];
-                const float             vy  = attrib.vertices[3 * idx.vertex_index + 1];
-                const float             vz  = attrib.vertices[3 * idx.vertex_index + 2];
+                model.unindexed_vertex_count++;
+                const auto [corner, added] = vertex_of_corner.try_emplace({idx.vertex_index, idx.normal_index, idx.texcoord_index},
+                                                                          static_cast<std::uint32_t>(model.combined_data.size() / vertex_stride));
+                model.indices.push_back(corner->second);
+                if (!added)
+                    continue;
+
+                const float vx = attrib.vertices[3 * idx.vertex_index + 0];
+                const float vy = attrib.vertices[3 * idx.vertex_index + 1];
+                const float vz = attrib.vertices[3 * idx.vertex_index + 2];
 
                 // Vertex positions
                 model.combined_data.push_back(vx);
@@ -92,5 +121,11 @@ ModelLoader::Model ModelLoader::process_model(const tinyobj::attrib_t& attrib, c
         }
     }
 
+    model.file_order_acmr = compute_acmr(model.indices);
+    optimize_vertex_cache(model.indices, model.combined_data.size() / vertex_stride);
+    optimize_overdraw(model.indices, model.combined_data, vertex_stride);
+    optimize_vertex_fetch(model.combined_data, vertex_stride, model.indices);
+    model.acmr = compute_acmr(model.indices);
+
     return model;
 }
@@ -1,13 +1,23 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include "tiny_obj_loader.h"
 
 class ModelLoader {
 public:
+    static constexpr std::size_t vertex_stride = 8; // Floats per vertex: position, normal, texture coordinates
+
+    // Vertices shared by the triangles of the mesh, ordered for the vertex cache, see mesh_optimizer.hpp
     struct Model {
-        std::vector<float> combined_data;
+        std::vector<float>         combined_data;
+        std::vector<std::uint32_t> indices;
+
+        std::size_t unindexed_vertex_count = 0; // One per corner of each face, what glDrawArrays would transform
+        float       file_order_acmr        = 0.f;
+        float       acmr                   = 0.f;
     };
 
     static Model load_model(const std::string& file_path);
@@ -0,0 +1,181 @@
+#include "vertex_packing.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "glm/gtc/packing.hpp"
+#include "model_loader.hpp"
+
+std::size_t vertex_format_stride(VertexFormat format)
+{
+    switch (format)
+    {
+    case VertexFormat::Float:
+        return ModelLoader::vertex_stride * sizeof(float);
+    case VertexFormat::Compact16:
+        return 16;
+    case VertexFormat::Compact8:
+        return 12;
+    }
+    return 0;
+}
+
+const char* vertex_format_name(VertexFormat format)
+{
+    switch (format)
+    {
+    case VertexFormat::Float:
+        return "float";
+    case VertexFormat::Compact16:
+        return "compact16";
+    case VertexFormat::Compact8:
+        return "compact8";
+    }
+    return "unknown";
+}
+
+// Octahedral encoding: the unit sphere folded onto the square [-1, 1]², the lower half mirrored around the diagonals
+static void encode_octahedral(glm::vec3 normal, float& u, float& v)
+{
+    const float sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (sum == 0.f)
+    {
+        u = 0.f;
+        v = 0.f;
+        return;
+    }
+    u = normal.x / sum;
+    v = normal.y / sum;
+    if (normal.z < 0.f)
+    {
+        const float folded_u = (1.f - std::abs(v)) * (u >= 0.f ? 1.f : -1.f);
+        const float folded_v = (1.f - std::abs(u)) * (v >= 0.f ? 1.f : -1.f);
+        u                    = folded_u;
+        v                    = folded_v;
+    }
+}
+
+// Same as oct_decode() in 3D.vs.glsl
+static glm::vec3 decode_octahedral(float u, float v)
+{
+    glm::vec3   normal(u, v, 1.f - std::abs(u) - std::abs(v));
+    const float t = std::max(-normal.z, 0.f);
+    normal.x += normal.x >= 0.f ? -t : t;
+    normal.y += normal.y >= 0.f ? -t : t;
+    return glm::normalize(normal);
+}
+
+template<typename Integer>
+static Integer quantize_signed(float value, float scale)
+{
+    return static_cast<Integer>(std::lround(std::clamp(value, -1.f, 1.f) * scale));
+}
+
+static float angle_degrees(glm::vec3 a, glm::vec3 b)
+{
+    return std::acos(std::clamp(glm::dot(a, b), -1.f, 1.f)) * 180.f / 3.14159265f;
+}
+
+template<typename T>
+static void write(std::byte* destination, const T& value)
+{
+    std::memcpy(destination, &value, sizeof(T));
+}
+
+PackedVertices pack_vertices(std::span<const float> vertices)
+{
+    constexpr std::size_t stride       = ModelLoader::vertex_stride;
+    const std::size_t     vertex_count = vertices.size() / stride;
+    PackedVertices        packed;
+
+    auto position = [&](std::size_t i) { return glm::vec3(vertices[i * stride], vertices[i * stride + 1], vertices[i * stride + 2]); };
+    auto normal   = [&](std::size_t i) { return glm::vec3(vertices[i * stride + 3], vertices[i * stride + 4], vertices[i * stride + 5]); };
+
+    // Errors of the compact formats decide which one is used
+    glm::vec3 min(0.f);
+    glm::vec3 max(0.f);
+    float     normal_error_8  = 0.f;
+    float     normal_error_16 = 0.f;
+    for (std::size_t i = 0; i < vertex_count; i++)
+    {
+        min = i == 0 ? position(i) : glm::min(min, position(i));
+        max = i == 0 ? position(i) : glm::max(max, position(i));
+
+        for (std::size_t k = 6; k < 8; k++)
+        {
+            const float uv      = vertices[i * stride + k];
+            packed.max_uv_error = std::max(packed.max_uv_error, std::abs(glm::unpackHalf1x16(glm::packHalf1x16(uv)) - uv));
+        }
+
+        const glm::vec3 n = normal(i);
+        if (glm::dot(n, n) == 0.f)
+            continue; // Missing normals have no error
+        float u, v;
+        encode_octahedral(glm::normalize(n), u, v);
+        const glm::vec3 n8  = decode_octahedral(static_cast<float>(quantize_signed<std::int8_t>(u, 127.f)) / 127.f, static_cast<float>(quantize_signed<std::int8_t>(v, 127.f)) / 127.f);
+        const glm::vec3 n16 = decode_octahedral(static_cast<float>(quantize_signed<std::int16_t>(u, 32767.f)) / 32767.f, static_cast<float>(quantize_signed<std::int16_t>(v, 32767.f)) / 32767.f);
+        normal_error_8      = std::max(normal_error_8, angle_degrees(glm::normalize(n), n8));
+        normal_error_16     = std::max(normal_error_16, angle_degrees(glm::normalize(n), n16));
+    }
+
+    if (packed.max_uv_error > uv_error_tolerance || normal_error_16 > normal_error_tolerance_degrees)
+        packed.format = VertexFormat::Float;
+    else if (normal_error_8 <= normal_error_tolerance_degrees)
+        packed.format = VertexFormat::Compact8;
+    else
+        packed.format = VertexFormat::Compact16;
+    packed.max_normal_error_degrees = packed.format == VertexFormat::Compact8 ? normal_error_8 : packed.format == VertexFormat::Compact16 ? normal_error_16 : 0.f;
+
+    const std::size_t vertex_size = vertex_format_stride(packed.format);
+    packed.data.resize(vertex_count * vertex_size);
+    if (packed.format == VertexFormat::Float)
+    {
+        packed.max_uv_error = 0.f;
+        std::memcpy(packed.data.data(), vertices.data(), packed.data.size());
+        return packed;
+    }
+
+    // A flat mesh keeps an extent of 1 on its flat axis, so that decoding never divides by 0
+    packed.position_min    = min;
+    packed.position_extent = max - min;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (packed.position_extent[axis] <= 0.f)
+            packed.position_extent[axis] = 1.f;
+    }
+    const float normal_scale = packed.format == VertexFormat::Compact8 ? 127.f : 32767.f;
+    packed.normal_scale      = normal_scale;
+
+    for (std::size_t i = 0; i < vertex_count; i++)
+    {
+        std::byte* vertex = &packed.data[i * vertex_size];
+
+        const glm::vec3 p = position(i);
+        for (int axis = 0; axis < 3; axis++)
+        {
+            const float normalized = (p[axis] - packed.position_min[axis]) / packed.position_extent[axis];
+            write(vertex + 2 * axis, static_cast<std::uint16_t>(std::lround(std::clamp(normalized, 0.f, 1.f) * 65535.f)));
+        }
+
+        float           u = 0.f;
+        float           v = 0.f;
+        const glm::vec3 n = normal(i);
+        if (glm::dot(n, n) > 0.f)
+            encode_octahedral(glm::normalize(n), u, v);
+        if (packed.format == VertexFormat::Compact8)
+        {
+            write(vertex + 6, quantize_signed<std::int8_t>(u, normal_scale));
+            write(vertex + 7, quantize_signed<std::int8_t>(v, normal_scale));
+        }
+        else
+        {
+            write(vertex + 6, std::uint16_t{0}); // Padding, keeps the normal 4-byte aligned
+            write(vertex + 8, quantize_signed<std::int16_t>(u, normal_scale));
+            write(vertex + 10, quantize_signed<std::int16_t>(v, normal_scale));
+        }
+
+        const std::size_t uv_offset = vertex_size - 4;
+        write(vertex + uv_offset, glm::packHalf1x16(vertices[i * stride + 6]));
+        write(vertex + uv_offset + 2, glm::packHalf1x16(vertices[i * stride + 7]));
+    }
+    return packed;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "glm/glm.hpp"
+
+// Layouts of the vertices in GPU memory, decoded by 3D.vs.glsl
+enum class VertexFormat : std::uint8_t {
+    Float,     // 32 bytes: position, normal and texture coordinates as floats
+    Compact16, // 16 bytes: 16-bit positions in the mesh bounds (and padding), 16-bit octahedral normals, half-float UVs
+    Compact8,  // 12 bytes: 16-bit positions in the mesh bounds, 8-bit octahedral normals, half-float UVs
+};
+
+std::size_t vertex_format_stride(VertexFormat format);
+const char* vertex_format_name(VertexFormat format);
+
+struct PackedVertices {
+    VertexFormat           format;
+    std::vector<std::byte> data;
+    glm::vec3              position_min{0.f};    // Positions are position_min + stored * position_extent
+    glm::vec3              position_extent{1.f}; // Stored positions are in [0, 1] once normalized
+    float                  normal_scale = 0.f;   // Above 0, normals are octahedral integers up to that value
+
+    // Largest errors of the compact formats, measured while choosing
+    float max_normal_error_degrees = 0.f;
+    float max_uv_error             = 0.f;
+};
+
+// Picks the smallest format that keeps the mesh within the tolerances below, then packs the vertices in it.
+// vertices holds ModelLoader::vertex_stride floats per vertex.
+constexpr float normal_error_tolerance_degrees = 0.5f;          // 8-bit octahedral normals are up to about 0.95° off
+constexpr float uv_error_tolerance             = 1.f / 4096.f; // Half a texel of a 2048 texture
+
+PackedVertices pack_vertices(std::span<const float> vertices);
@@ -1,19 +1,38 @@
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
+#include <limits>
+#include <optional>
+#include <string>
+#include <utility>
 #include <vector>
 #include "glimac/trackball_camera.hpp"
 #include "glm/ext/matrix_clip_space.hpp"
 #include "glm/fwd.hpp"
+#include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtc/type_ptr.hpp"
 #include "render/game_object.hpp"
+#include "render/gl_state.hpp"
+#include "render/instance_buffer.hpp"
 #include "scene_objects/boid.hpp"
 #define DOCTEST_CONFIG_IMPLEMENT
 #include "doctest/doctest.h"
+#include "3D_loader/mesh_report.hpp"
 #include "maths/color.hpp"
+#include "maths/cpu_dispatch.hpp"
 #include "maths/random_generator.hpp"
+#include "profiling/profiler.hpp"
 #include "render/program.hpp"
+#include "render/quality_controller.hpp"
+#include "render/render_queue.hpp"
+#include "render/view_distances.hpp"
+#include "scenario/scenario.hpp"
 #include "scene_objects/planet.hpp"
 #include "scene_objects/surveyor.hpp"
+#include "simulation/flock_stream_client.hpp"
+#include "simulation/headless_runner.hpp"
+#include "simulation/simulation_thread.hpp"
 
 struct Light {
     glm::vec3 position;  // Light position in view space
@@ -36,16 +55,34 @@ int time_events(int next_event_time, Surveyor& chain, p6::Context& ctx)
     return next_event_time;
 }
 
-void handle_camera_input(p6::Context& ctx, TrackballCamera& camera, float& last_x, float& last_y)
+// Left clicks that did not drag the camera, they pick the boid under the mouse
+struct MousePick {
+    static constexpr float max_travel = 0.01f; // Farther between press and release, the click was a drag
+
+    glm::vec2                press_position{0.f};
+    std::optional<glm::vec2> click; // Where the button was released, until the frame handles it
+};
+
+// Accumulates the camera moves of the frame into input, they are applied with FrameInput::apply_to_camera()
+void handle_camera_input(p6::Context& ctx, FrameInput& input, float& last_x, float& last_y, MousePick& pick)
 {
+    ctx.mouse_pressed = [&](p6::MouseButton button) {
+        if (button.button == p6::Button::Left)
+            pick.press_position = button.position;
+    };
+    ctx.mouse_released = [&](p6::MouseButton button) {
+        if (button.button == p6::Button::Left && glm::length(button.position - pick.press_position) < MousePick::max_travel)
+            pick.click = button.position;
+    };
+
     ctx.mouse_dragged = [&](p6::MouseDrag drag) {
         float deltaX = drag.position.x - last_x;
         float deltaY = drag.position.y - last_y;
 
         if (last_x != 0 && last_y != 0)
         {
-            camera.rotate_left(-deltaX * 25.f);
-            camera.rotate_up(deltaY * 25.f);
+            input.camera_rotate_left += -deltaX * 25.f;
+            input.camera_rotate_up += deltaY * 25.f;
         }
 
         last_x = drag.position.x;
@@ -60,28 +97,148 @@ void handle_camera_input(p6::Context& ctx, TrackballCamera& camera, float& last_
 
     if (ctx.mouse_button_is_pressed(p6::Button::Right))
     {
-        camera.reset_camera();
+        input.camera_reset = true;
     }
 
     ctx.mouse_scrolled = [&](p6::MouseScroll scroll) {
-        camera.move_front(-scroll.dy);
+        input.camera_move_front += -scroll.dy;
     };
 }
 
-int main()
+// Boid whose star is under the mouse, found with a ray through the snapshot index
+std::optional<std::uint32_t> pick_boid(const FlockSnapshot& flock, glm::vec2 mouse, float aspect_ratio, const glm::mat4& view_matrix, const glm::mat4& proj_matrix)
 {
+    constexpr float pick_radius = 0.15f; // A bit larger than a star, so that they are easy to click
+
+    // p6 puts the mouse in [-aspect_ratio, aspect_ratio] x [-1, 1]
+    const glm::vec2 ndc(mouse.x / aspect_ratio, mouse.y);
+    const glm::mat4 inverse_view_proj = glm::inverse(proj_matrix * view_matrix);
+    const glm::vec4 near              = inverse_view_proj * glm::vec4(ndc.x, ndc.y, -1.f, 1.f);
+    const glm::vec4 far               = inverse_view_proj * glm::vec4(ndc.x, ndc.y, 1.f, 1.f);
+    const glm::vec3 origin            = glm::vec3(near) / near.w;
+    const glm::vec3 direction         = glm::normalize(glm::vec3(far) / far.w - origin);
+
+    const std::optional<RayHit> hit = flock.index.raycast(flock.positions, origin, direction, 100.f, pick_radius);
+    if (!hit)
+        return std::nullopt;
+    return hit->index;
+}
+
+int main(int argc, char* argv[])
+{
+    Profiler::set_thread_name("Main");
+    const std::string cpu_dispatch = describe_cpu_dispatch();
+
+    // --tests [doctest options]: runs the unit tests of src/tests.cpp
+    if (argc > 1 && std::string(argv[1]) == "--tests")
+    {
+        doctest::Context context(argc - 1, argv + 1);
+        return context.run();
+    }
+
+    // --headless [steps] [boid count] [shared memory name]: simulation only, statistics printed as CSV
+    if (argc > 1 && std::string(argv[1]) == "--headless")
+    {
+        srand(time(NULL));
+        HeadlessOptions options;
+        if (argc > 2)
+            options.steps = std::stoull(argv[2]);
+        if (argc > 3)
+            options.boid_count = std::stoull(argv[3]);
+        if (argc > 4)
+            options.shared_memory_name = argv[4];
+        std::cout << "# " << cpu_dispatch << '\n';
+        return run_headless(options, BoidVariables{});
+    }
+
+    // --mesh-report [directory]: memory of the meshes in their indexed and quantized layouts, printed as CSV
+    if (argc > 1 && std::string(argv[1]) == "--mesh-report")
+    {
+        return print_mesh_report(argc > 2 ? argv[2] : "assets/models");
+    }
+
+    // --serve <address> [boid count] [steps]: headless simulation in real time, streamed to the viewers of the socket
+    // Addresses are "unix:<path>", "<port>" or "<host>:<port>", see simulation/stream_socket.hpp
+    if (argc > 2 && std::string(argv[1]) == "--serve")
+    {
+        srand(time(NULL));
+        HeadlessOptions options;
+        options.stream_address = argv[2];
+        options.steps          = std::numeric_limits<std::uint64_t>::max();
+        if (argc > 3)
+            options.boid_count = std::stoull(argv[3]);
+        if (argc > 4)
+            options.steps = std::stoull(argv[4]);
+        std::cout << "# " << cpu_dispatch << '\n';
+        return run_headless(options, BoidVariables{});
+    }
+
+    // --record <file>: saves the input of the session to replay it later
+    // --scenario <file>: replays a recorded session with a fixed time step, then prints frame time percentiles
+    // --shared-memory <name>: publishes every step of the flock to POSIX shared memory, see tools/shared_flock_reader.cpp
+    // --view <address>: renders the flock streamed by a `--serve` instance instead of simulating it
+    std::optional<Scenario>          recording;
+    std::optional<ScenarioPlayer>    replay;
+    std::optional<FlockStreamClient> viewer;
+    std::string                      recording_path;
+    std::string                      shared_memory_name;
+    if (argc > 2 && std::string(argv[1]) == "--record")
+    {
+        recording_path = argv[2];
+        recording      = Scenario{static_cast<unsigned>(time(NULL)), 0, {}};
+    }
+    else if (argc > 2 && std::string(argv[1]) == "--scenario")
+    {
+        std::optional<Scenario> scenario = Scenario::load(argv[2]);
+        if (!scenario)
+            return EXIT_FAILURE;
+        replay.emplace(std::move(*scenario));
+    }
+    else if (argc > 2 && std::string(argv[1]) == "--shared-memory")
+    {
+        shared_memory_name = argv[2];
+    }
+    else if (argc > 2 && std::string(argv[1]) == "--view")
+    {
+        viewer.emplace();
+        if (!viewer->connect(argv[2]))
+            return EXIT_FAILURE;
+    }
+
+    std::cout << cpu_dispatch << std::endl;
+
     auto ctx = p6::Context{{1280, 720, "Space Boids - Barthe & Duval"}};
     ctx.maximize_window();
     glEnable(GL_DEPTH_TEST);
 
     // Seed the random number generator
-    srand(time(NULL));
+    const unsigned seed = replay ? replay->get_scenario().seed : recording ? recording->seed : static_cast<unsigned>(time(NULL));
+    srand(seed);
+
+    if (replay)
+    {
+        // Replays must not depend on how fast this machine renders
+        ctx.time_perceived_as_constant_delta_time(60.f);
+    }
+
+    TrackballCamera                 camera;
+    BoidVariables                   coeffs;
+    int                             boid_count = replay ? static_cast<int>(replay->get_scenario().boid_count) : 80;
+    std::optional<SimulationThread> simulation; // Viewers render the streamed flock, they have none
+    Program                         boids_program{};
+    Light                           lights[2];
+    if (!viewer)
+    {
+        simulation.emplace(static_cast<std::size_t>(boid_count), coeffs);
+    }
+
+    if (recording)
+    {
+        recording->boid_count = static_cast<std::size_t>(boid_count);
+    }
 
-    TrackballCamera   camera;
-    BoidVariables     coeffs;
-    std::vector<Boid> boids(80);
-    Program           boids_program{};
-    Light             lights[2];
+    if (!shared_memory_name.empty() && !simulation->export_to_shared_memory(shared_memory_name))
+        return EXIT_FAILURE;
 
     double next_event_time = 0.0;
 
@@ -120,32 +277,180 @@ int main()
 
     auto planets = Planet::create_planets();
 
-    float last_x = 0;
-    float last_y = 0;
+    // The planets do not move, only the goal of the flow field is updated every frame
+    FlowTargets flow_targets;
+    for (const auto& planet : planets)
+    {
+        const GameObject* object = planet.get_game_object();
+        flow_targets.obstacles.push_back({object->get_position(), object->get_scale().x});
+    }
+
+    float                        last_x = 0;
+    float                        last_y = 0;
+    FrameInput                   live_input;
+    std::vector<float>           boid_distances; // Squared, from the camera
+    InstanceBuffer               star_instances;
+    RenderQueue                  render_queue;
+    QualityController            quality;
+    std::size_t                  applied_quality_level = 0; // Of the variables given to the simulation
+    std::vector<std::uint32_t>   visible_boids;
+    MousePick                    mouse_pick;
+    std::optional<std::uint32_t> picked_boid; // Index in the snapshot, dropped as soon as boids are spawned or despawned
+    std::uint64_t                picked_population = 0; // FlockSnapshot::population when it was picked
+    const Color                  picked_color(1.f, 1.f, 1.f);
+    if (replay)
+    {
+        // Recordings start at the best level, then follow their quality edits
+        quality.freeze_at(0);
+    }
 
     glm::vec3 lightPosition(0.0f, 0.0f, 0.0f);
     float     lightMotionRadius = 8.0f;
     float     lightMotionSpeed  = 0.5f;
     lights[0].intensity         = glm::vec3(2.0f, 2.0f, 2.0f);
 
+    ctx.key_pressed = [&](p6::Key key) {
+        if (key.physical == GLFW_KEY_F9)
+        {
+            Profiler::export_chrome_trace(Profiler::default_trace_path);
+        }
+    };
+
     ctx.update = [&]() {
-        next_event_time = time_events(next_event_time, player, ctx);
+        Profiler::collect();
+        if (replay && !replay->begin_frame())
+        {
+            replay->get_report().print(std::cout);
+            ctx.stop();
+            return;
+        }
+        PROFILE_ZONE("Frame");
+        const auto frame_start = std::chrono::steady_clock::now();
+        GLState::begin_frame();
+
+        handle_camera_input(ctx, live_input, last_x, last_y, mouse_pick);
+        live_input.surveyor_keys = FrameInput::read_surveyor_keys(ctx);
+        FrameInput input         = replay ? replay->get_input() : live_input;
+        live_input               = FrameInput{};
+        if (replay)
+        {
+            // The simulation runs in lockstep with the frames so that replays are deterministic
+            simulation->step_now();
+        }
 
-        ImGui::Begin("Boids command panel");
-        ImGui::Text("Play with the parameters of the flock!");
-        coeffs.draw_Gui();
-        ImGui::End();
+        const FlockSnapshot& flock = viewer ? viewer->latest_snapshot() : simulation->latest_snapshot();
+        if (picked_boid && (flock.population != picked_population || *picked_boid >= flock.positions.size()))
+        {
+            picked_boid = std::nullopt;
+        }
+        {
+            PROFILE_ZONE("ImGui");
+            ImGui::Begin("Boids command panel");
+            ImGui::Text("Play with the parameters of the flock!");
+            // Replays only apply the recorded edits, and widgets edit the input of the frame so that it can be recorded
+            ImGui::BeginDisabled(replay.has_value());
+            BoidVariables edited_coeffs = coeffs;
+            if (edited_coeffs.draw_Gui())
+            {
+                input.variables = edited_coeffs;
+            }
+            // Boids are spawned and despawned by the simulation thread, at most one pool chunk is allocated per 16k new boids
+            int edited_boid_count = boid_count;
+            if (viewer)
+            {
+                viewer->draw_Gui();
+            }
+            else if (ImGui::SliderInt("Boid count", &edited_boid_count, 0, 200000, "%d", ImGuiSliderFlags_Logarithmic))
+            {
+                input.boid_count = static_cast<std::size_t>(edited_boid_count);
+            }
+            bool variables_changed = quality.draw_Gui();
+            ImGui::EndDisabled();
+
+            // Levels chosen by the controller at the end of the previous frame are recorded with the edits, so that
+            // replays do not depend on the frame times of the machine they run on
+            if (replay)
+            {
+                if (input.quality_level)
+                    quality.freeze_at(*input.quality_level);
+            }
+            else if (quality.get_level_index() != applied_quality_level)
+            {
+                input.quality_level = quality.get_level_index();
+            }
+            if (input.quality_level)
+            {
+                applied_quality_level = *input.quality_level;
+                variables_changed     = true;
+            }
+            if (input.variables)
+            {
+                coeffs            = *input.variables;
+                variables_changed = true;
+            }
+            if (simulation && input.boid_count)
+            {
+                boid_count = static_cast<int>(*input.boid_count);
+                simulation->set_boid_count(*input.boid_count);
+            }
+            if (simulation && variables_changed)
+            {
+                simulation->set_variables(quality.apply_simulation_tier(coeffs));
+            }
+            flock.draw_Gui();
+            {
+                // Regions around the surveyor, counted through the snapshot index rather than by scanning the flock
+                constexpr float   region_radius = 2.f;
+                const glm::vec3   surveyor      = thwomp_object.get_position();
+                const std::size_t in_sphere     = flock.index.count_in_sphere(flock.positions, surveyor, region_radius);
+                const std::size_t in_box        = flock.index.count_in_box(flock.positions, surveyor - region_radius, surveyor + region_radius);
+                ImGui::Text("Around the surveyor: %zu boids within %.1f, %zu in the box of half size %.1f", in_sphere, region_radius, in_box, region_radius);
+            }
+            const StreamingBuffer& instance_stream = star_instances.get_stream();
+            ImGui::Text("Star instances: %s, %llu stalls", instance_stream.is_persistent() ? "persistent mapping" : "orphaned every frame",
+                        static_cast<unsigned long long>(instance_stream.get_stall_count()));
+            GLState::draw_Gui();
+            render_queue.draw_Gui();
+            if (picked_boid)
+            {
+                const glm::vec3& position = flock.positions[*picked_boid];
+                ImGui::Text("Picked boid %u at (%.2f, %.2f, %.2f)", *picked_boid, position.x, position.y, position.z);
+            }
+            ImGui::End();
+            Profiler::draw_Gui();
+        }
 
         glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        player.move_surveyor_with_wiggle(ctx);
+        {
+            PROFILE_ZONE("Surveyor update");
+            next_event_time = time_events(next_event_time, player, ctx);
+            player.move_surveyor_with_wiggle(ctx, input.surveyor_keys);
+        }
+        flow_targets.goal = thwomp_object.get_position();
+        if (simulation)
+        {
+            simulation->set_flow_targets(flow_targets);
+        }
         camera.set_center(thwomp_object.get_position());
-        handle_camera_input(ctx, camera, last_x, last_y);
+        input.apply_to_camera(camera);
 
         glm::mat4 view_matrix = camera.get_view_matrix();
         glm::mat4 proj_matrix = glm::perspective(glm::radians(70.f), ctx.aspect_ratio(), 0.1f, 100.f);
 
+        if (mouse_pick.click && !replay)
+        {
+            input.picked      = true;
+            input.picked_boid = pick_boid(flock, *mouse_pick.click, ctx.aspect_ratio(), view_matrix, proj_matrix);
+        }
+        mouse_pick.click = std::nullopt;
+        if (input.picked)
+        {
+            picked_boid       = input.picked_boid;
+            picked_population = flock.population;
+        }
+
         // Update light position
         float time      = ctx.time();
         lightPosition.x = sin(time * lightMotionSpeed) * lightMotionRadius;
@@ -161,43 +466,81 @@ int main()
         lights[1].intensity = player.get_light_intensity();
 
         boids_program.use();
-        glUniform3fv(boids_program.u_light_pos_vs_0, 1, glm::value_ptr(lights[0].position));
-        glUniform3fv(boids_program.u_light_intensity_0, 1, glm::value_ptr(lights[0].intensity));
-        glUniform3fv(boids_program.u_light_pos_vs_1, 1, glm::value_ptr(lights[1].position));
-        glUniform3fv(boids_program.u_light_intensity_1, 1, glm::value_ptr(lights[1].intensity));
+        GLState::uniform(boids_program.u_light_pos_vs_0, lights[0].position);
+        GLState::uniform(boids_program.u_light_intensity_0, lights[0].intensity);
+        GLState::uniform(boids_program.u_light_pos_vs_1, lights[1].position);
+        GLState::uniform(boids_program.u_light_intensity_1, lights[1].intensity);
 
-        glEnable(GL_CULL_FACE);
-
-        glCullFace(GL_FRONT);
-        for (auto& b : boids)
         {
-            star_boid.set_position(b.get_position());
-            star_boid.render_edge(boids_program, view_matrix, proj_matrix, 1.1);
+            // Distances of the stars to the camera choose which ones are drawn and with which mesh
+            compute_view_distances(flock.positions, view_matrix, boid_distances);
+            quality.select_visible(boid_distances, visible_boids);
         }
-        thwomp_object.render_edge(boids_program, view_matrix, proj_matrix, 1.05);
-        for (const auto& planet : planets)
+        std::size_t star_count     = 0; // High-poly stars, at the front of the instances
+        std::size_t star_low_first = 0; // Low-poly stars, from there to the end
+        std::size_t star_low_count = 0;
         {
-            planet.get_game_object()->render_edge(boids_program, view_matrix, proj_matrix, 1.025);
+            PROFILE_ZONE("Instance upload");
+            // Visible stars are written straight into the mapped buffer, high-poly ones from the front and low-poly
+            // ones from the back, so that each mesh draws its own range in one call per pass
+            const float             lod_distance  = quality.get_level().lod_distance;
+            const float             lod_distance2 = lod_distance * lod_distance;
+            std::span<InstanceData> instances     = star_instances.begin_frame(visible_boids.size());
+            star_low_first                        = instances.size();
+            for (std::size_t k = 0; k < instances.size(); k++)
+            {
+                const std::uint32_t i      = visible_boids[k];
+                const bool          far    = boid_distances[i] > lod_distance2;
+                const bool          picked = picked_boid == i;
+                InstanceData&       slot   = coeffs.isLowPoly || far ? instances[--star_low_first] : instances[star_count++];
+                slot                       = {flock.positions[i], picked ? 1.5f : 1.f, picked ? picked_color : flock.colors[i]};
+            }
+            star_instances.end_writing();
+            star_low_count = instances.size() - star_low_first;
         }
-        space_object.render_game_object(boids_program, view_matrix, proj_matrix);
 
-        glCullFace(GL_BACK);
-        thwomp_object.render_game_object(boids_program, view_matrix, proj_matrix);
-        for (auto& b : boids)
         {
-            auto& star_to_render = coeffs.isLowPoly ? star_boid_low : star_boid;
-            star_to_render.change_color(b.get_color());
-            star_to_render.set_position(b.get_position());
-            star_to_render.render_game_object(boids_program, view_matrix, proj_matrix);
-            b.update(&ctx, boids, coeffs);
+            PROFILE_ZONE("Render queue submit");
+            // Outlines are drawn by the same calls as their objects
+            star_boid.submit_instances(render_queue, boids_program, star_instances, 0, star_count, 1.1f);
+            star_boid_low.submit_instances(render_queue, boids_program, star_instances, star_low_first, star_low_count, 1.1f);
+            thwomp_object.submit(render_queue, RenderPass::FrontFaces, boids_program, view_matrix, 1.05f);
+            for (const auto& planet : planets)
+            {
+                planet.get_game_object()->submit(render_queue, RenderPass::FrontFaces, boids_program, view_matrix, 1.025f);
+            }
+            // Seen from the inside
+            space_object.submit(render_queue, RenderPass::BackFaces, boids_program, view_matrix);
         }
-        for (const auto& planet : planets)
+        render_queue.draw(view_matrix, proj_matrix);
+
+        star_instances.end_frame();
+        if (replay)
         {
-            planet.get_game_object()->render_game_object(boids_program, view_matrix, proj_matrix);
+            replay->end_frame();
+        }
+        if (recording)
+        {
+            recording->frames.push_back(std::move(input));
         }
 
-        glDisable(GL_CULL_FACE);
+        // The budget is for the work of the frame, waiting for the swap does not count. A new level is applied after the
+        // GUI of the next frame.
+        quality.add_frame(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frame_start).count());
     };
 
+    if (simulation && !replay)
+    {
+        simulation->start();
+    }
     ctx.start();
+    if (simulation)
+    {
+        simulation->stop();
+    }
+
+    if (recording)
+    {
+        recording->save(recording_path);
+    }
 }
@@ -0,0 +1,29 @@
+#include "counter_rng.hpp"
+#include "cpu_dispatch.hpp"
+
+using FillKernel = void (*)(std::uint64_t key, std::uint64_t counter, std::span<float> values);
+
+static void fill_portable(std::uint64_t key, std::uint64_t counter, std::span<float> values)
+{
+    for (std::size_t i = 0; i < values.size(); i++)
+    {
+        values[i] = CounterRng::to_float(CounterRng::mix(key + (counter + i) * 0x9E3779B97F4A7C15ull));
+    }
+}
+
+BOIDS_TARGET_AVX2 static void fill_avx2(std::uint64_t key, std::uint64_t counter, std::span<float> values)
+{
+    fill_portable(key, counter, values);
+}
+
+BOIDS_TARGET_AVX512 static void fill_avx512(std::uint64_t key, std::uint64_t counter, std::span<float> values)
+{
+    fill_portable(key, counter, values);
+}
+
+void CounterRng::fill(std::span<float> values)
+{
+    static const FillKernel kernel = select_kernel<FillKernel>(active_isa(), &fill_portable, &fill_avx2, &fill_avx512);
+    kernel(m_key, m_counter, values);
+    m_counter += values.size();
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+// Counter-based random numbers: the n-th draw of a stream is a hash of its key and n, with no state shared between
+// streams. Keying a stream by step and boid gives the same draws whatever the thread that steers the boid.
+class CounterRng {
+public:
+    CounterRng(std::uint64_t seed, std::uint64_t stream)
+        : m_key(mix(seed ^ mix(stream + 0x9E3779B97F4A7C15ull))) {}
+
+    std::uint64_t next_u64() { return mix(m_key + m_counter++ * 0x9E3779B97F4A7C15ull); }
+
+    // Uniform in [0, 1)
+    float next_float() { return to_float(next_u64()); }
+
+    // Same values as calling next_float() values.size() times, but every draw is independent of the others, so the
+    // loop runs on wide registers with the copy matching the CPU, see cpu_dispatch.hpp
+    void fill(std::span<float> values);
+
+    // SplitMix64 finalizer
+    static std::uint64_t mix(std::uint64_t x)
+    {
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+
+    // Uniform in [0, 1), from the 24 high bits so that every value is exact
+    static float to_float(std::uint64_t bits) { return static_cast<float>(static_cast<std::int32_t>(bits >> 40)) * (1.f / 16777216.f); }
+
+private:
+    std::uint64_t m_key;
+    std::uint64_t m_counter = 0;
+};
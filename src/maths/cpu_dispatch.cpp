@@ -0,0 +1,63 @@
+#include "cpu_dispatch.hpp"
+#include <cstdlib>
+#include <iostream>
+
+Isa detect_isa()
+{
+#if BOIDS_MULTIVERSION
+    // Also checks that the OS saves the wide registers
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512bw"))
+        return Isa::Avx512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return Isa::Avx2;
+#endif
+    return Isa::Portable;
+}
+
+static Isa requested_isa(Isa detected)
+{
+    const char* value = std::getenv("BOIDS_ISA");
+    if (value == nullptr)
+        return detected;
+
+    const std::string name(value);
+    for (Isa isa : {Isa::Portable, Isa::Avx2, Isa::Avx512})
+    {
+        if (name != isa_name(isa))
+            continue;
+        if (isa > detected)
+        {
+            std::cerr << "Error: BOIDS_ISA=" << name << " is not supported by this CPU, using " << isa_name(detected) << '\n';
+            return detected;
+        }
+        return isa;
+    }
+    std::cerr << "Error: unknown BOIDS_ISA=" << name << ", expected portable, avx2 or avx512\n";
+    return detected;
+}
+
+Isa active_isa()
+{
+    static const Isa isa = requested_isa(detect_isa());
+    return isa;
+}
+
+const char* isa_name(Isa isa)
+{
+    switch (isa)
+    {
+    case Isa::Avx512: return "avx512";
+    case Isa::Avx2: return "avx2";
+    case Isa::Portable: break;
+    }
+    return "portable";
+}
+
+std::string describe_cpu_dispatch()
+{
+    std::string description = std::string("CPU dispatch: kernels use ") + isa_name(active_isa()) + ", CPU supports " + isa_name(detect_isa());
+    if (!BOIDS_MULTIVERSION)
+        description += " (this build only has the portable kernels)";
+    return description;
+}
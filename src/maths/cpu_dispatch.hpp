@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+
+// Instruction sets the hot kernels are compiled for. Each kernel is built once per set from the same portable code,
+// and the copy matching the CPU is picked when the program starts, so one binary runs on the whole fleet.
+enum class Isa {
+    Portable, // Baseline of the compiler, SSE2 on x86-64, and the reference the other copies are checked against
+    Avx2,     // AVX2 and FMA
+    Avx512,   // AVX-512 F, VL, DQ and BW
+};
+
+constexpr int isa_count = 3;
+
+// Copies are only compiled where the compiler can both target and detect the instruction sets
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define BOIDS_MULTIVERSION 1
+// flatten inlines everything the kernel calls, so that the callees are compiled for the target too
+#define BOIDS_TARGET_AVX2   __attribute__((target("avx2,fma"), flatten))
+#define BOIDS_TARGET_AVX512 __attribute__((target("avx512f,avx512vl,avx512dq,avx512bw,avx2,fma"), flatten))
+#else
+#define BOIDS_MULTIVERSION 0
+#define BOIDS_TARGET_AVX2
+#define BOIDS_TARGET_AVX512
+#endif
+
+// Best instruction set of this CPU among the ones kernels are compiled for
+Isa detect_isa();
+
+// Set used by the kernels: the detected one, or a lower one asked for with the BOIDS_ISA environment variable
+// ("portable", "avx2" or "avx512"). Decided on the first call and kept for the whole run.
+Isa active_isa();
+
+const char* isa_name(Isa isa);
+
+// One line telling which set the kernels use and why, logged at startup
+std::string describe_cpu_dispatch();
+
+// Picks the copy of a kernel compiled for isa
+template<typename Kernel>
+Kernel select_kernel(Isa isa, Kernel portable, Kernel avx2, Kernel avx512)
+{
+    switch (isa)
+    {
+    case Isa::Avx512: return avx512;
+    case Isa::Avx2: return avx2;
+    case Isa::Portable: break;
+    }
+    return portable;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+// Index in count sorted samples of the nearest-rank p-th percentile: the smallest sample that at least p% of the samples
+// are less than or equal to. Standard headers only, tools/shared_flock_reader.cpp uses it too.
+inline std::size_t percentile_index(std::size_t count, double p)
+{
+    const auto rank = static_cast<std::size_t>(std::ceil(p * static_cast<double>(count) / 100.));
+    return std::clamp<std::size_t>(rank, 1, std::max<std::size_t>(count, 1)) - 1;
+}
@@ -0,0 +1,287 @@
+#include "profiler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "p6/p6.h"
+
+struct ThreadTrack {
+    std::string              name;
+    std::uint32_t            id = 0;
+    ProfileEventBuffer       buffer;
+    std::deque<ProfileEvent> history; // Only touched by the collecting thread
+};
+
+struct ProfilerState {
+    std::mutex                                mutex; // Guards the track list and names, never taken while recording a zone
+    std::vector<std::shared_ptr<ThreadTrack>> tracks;
+    std::chrono::steady_clock::time_point     epoch = std::chrono::steady_clock::now();
+};
+
+static constexpr std::int64_t history_ns         = 10'000'000'000; // Events older than that are forgotten
+static constexpr std::int64_t timeline_window_ns = 100'000'000;
+static constexpr float        row_height         = 18.f;
+
+static thread_local std::shared_ptr<ThreadTrack> t_track;
+static thread_local std::uint32_t                t_depth = 0;
+
+static bool write_chrome_trace(const std::vector<std::shared_ptr<ThreadTrack>>& tracks, const std::string& file_path);
+
+static ProfilerState& state()
+{
+    static ProfilerState profiler_state;
+    return profiler_state;
+}
+
+static ThreadTrack& current_track()
+{
+    if (!t_track)
+    {
+        ProfilerState&   s = state();
+        std::lock_guard  lock(s.mutex);
+        t_track       = std::make_shared<ThreadTrack>();
+        t_track->id   = static_cast<std::uint32_t>(s.tracks.size() + 1);
+        t_track->name = "Thread " + std::to_string(t_track->id);
+        s.tracks.push_back(t_track);
+    }
+    return *t_track;
+}
+
+static ImU32 zone_color(const char* name)
+{
+    // Same name, same color from one frame to the next
+    std::uint32_t hash = 2166136261u;
+    for (const char* c = name; *c != '\0'; c++)
+    {
+        hash = (hash ^ static_cast<std::uint8_t>(*c)) * 16777619u;
+    }
+    return IM_COL32(80 + hash % 150, 80 + (hash >> 8) % 150, 80 + (hash >> 16) % 150, 255);
+}
+
+static void draw_zone(ImDrawList* draw_list, const ProfileEvent& event, ImVec2 min, ImVec2 max)
+{
+    draw_list->AddRectFilled(min, max, zone_color(event.name));
+    if (max.x - min.x > ImGui::CalcTextSize(event.name).x + 4.f)
+    {
+        draw_list->AddText({min.x + 2.f, min.y + 2.f}, IM_COL32(0, 0, 0, 255), event.name);
+    }
+    if (ImGui::IsMouseHoveringRect(min, max))
+    {
+        ImGui::SetTooltip("%s: %.3f ms", event.name, static_cast<double>(event.end_ns - event.start_ns) / 1e6);
+    }
+}
+
+// Zones of the last complete top-level zone of the calling thread (the frame on the render thread), stacked by depth
+static void draw_flame_graph()
+{
+    if (!t_track)
+        return;
+
+    const auto& history = t_track->history;
+    const auto  frame   = std::find_if(history.rbegin(), history.rend(), [](const ProfileEvent& e) { return e.depth == 0; });
+    if (frame == history.rend())
+        return;
+
+    const double duration = static_cast<double>(std::max<std::int64_t>(frame->end_ns - frame->start_ns, 1));
+    ImGui::Text("Last %s: %.3f ms", frame->name, duration / 1e6);
+
+    ImDrawList*  draw_list = ImGui::GetWindowDrawList();
+    const ImVec2 origin    = ImGui::GetCursorScreenPos();
+    const float  width     = std::max(ImGui::GetContentRegionAvail().x, 100.f);
+    std::uint32_t max_depth = 0;
+
+    for (const ProfileEvent& event : history)
+    {
+        if (event.start_ns < frame->start_ns || event.end_ns > frame->end_ns)
+            continue;
+
+        const float x0 = origin.x + static_cast<float>(static_cast<double>(event.start_ns - frame->start_ns) / duration) * width;
+        const float x1 = origin.x + static_cast<float>(static_cast<double>(event.end_ns - frame->start_ns) / duration) * width;
+        const float y0 = origin.y + static_cast<float>(event.depth) * row_height;
+        draw_zone(draw_list, event, {x0, y0}, {std::max(x1, x0 + 1.f), y0 + row_height - 1.f});
+        max_depth = std::max(max_depth, event.depth);
+    }
+    ImGui::Dummy({width, static_cast<float>(max_depth + 1) * row_height});
+}
+
+// Last timeline_window_ns of every thread, one lane per thread
+static void draw_timeline(const std::vector<std::shared_ptr<ThreadTrack>>& tracks)
+{
+    const std::int64_t window_end   = Profiler::now_ns();
+    const std::int64_t window_start = window_end - timeline_window_ns;
+    const float        width        = std::max(ImGui::GetContentRegionAvail().x, 100.f);
+
+    for (const auto& track : tracks)
+    {
+        ImGui::Text("%s", track->name.c_str());
+        if (track->buffer.get_dropped_count() > 0)
+        {
+            ImGui::SameLine();
+            ImGui::TextDisabled("(%llu events dropped)", static_cast<unsigned long long>(track->buffer.get_dropped_count()));
+        }
+
+        ImDrawList*   draw_list = ImGui::GetWindowDrawList();
+        const ImVec2  origin    = ImGui::GetCursorScreenPos();
+        std::uint32_t max_depth = 0;
+        for (const ProfileEvent& event : track->history)
+        {
+            if (event.end_ns < window_start)
+                continue;
+
+            const float x0 = origin.x + static_cast<float>(std::max(event.start_ns, window_start) - window_start) / static_cast<float>(timeline_window_ns) * width;
+            const float x1 = origin.x + static_cast<float>(event.end_ns - window_start) / static_cast<float>(timeline_window_ns) * width;
+            const float y0 = origin.y + static_cast<float>(event.depth) * row_height;
+            draw_zone(draw_list, event, {x0, y0}, {std::max(x1, x0 + 1.f), y0 + row_height - 1.f});
+            max_depth = std::max(max_depth, event.depth);
+        }
+        ImGui::Dummy({width, static_cast<float>(max_depth + 1) * row_height});
+    }
+}
+
+std::int64_t Profiler::now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - state().epoch).count();
+}
+
+void Profiler::set_thread_name(const std::string& name)
+{
+    ThreadTrack&    track = current_track();
+    std::lock_guard lock(state().mutex);
+    track.name = name;
+}
+
+void Profiler::record(const char* name, std::int64_t start_ns, std::int64_t end_ns, std::uint32_t depth)
+{
+    current_track().buffer.push({name, start_ns, end_ns, depth});
+}
+
+void Profiler::collect()
+{
+    ProfilerState&     s           = state();
+    const std::int64_t oldest_kept = now_ns() - history_ns;
+
+    std::lock_guard lock(s.mutex);
+    for (const auto& track : s.tracks)
+    {
+        track->buffer.drain([&](const ProfileEvent& event) { track->history.push_back(event); });
+        while (!track->history.empty() && track->history.front().end_ns < oldest_kept)
+        {
+            track->history.pop_front();
+        }
+    }
+}
+
+void Profiler::draw_Gui()
+{
+    ProfilerState&  s = state();
+    std::lock_guard lock(s.mutex);
+
+    ImGui::Begin("Profiler");
+#ifndef BOIDS_PROFILER
+    ImGui::TextWrapped("Built with ENABLE_PROFILER=OFF: no zone is recorded.");
+#endif
+    if (ImGui::Button("Export Chrome trace (F9)"))
+    {
+        write_chrome_trace(s.tracks, default_trace_path);
+    }
+    if (ImGui::CollapsingHeader("Flame graph"))
+    {
+        draw_flame_graph();
+    }
+    if (ImGui::CollapsingHeader("Timeline"))
+    {
+        draw_timeline(s.tracks);
+    }
+    ImGui::End();
+}
+
+static void write_json_string(std::ostream& out, const std::string& text)
+{
+    out << '"';
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+            out << '\\';
+        out << c;
+    }
+    out << '"';
+}
+
+std::vector<std::pair<std::string, double>> Profiler::last_frame_zones()
+{
+    std::vector<std::pair<std::string, double>> zones;
+    if (!t_track)
+        return zones;
+
+    const auto& history = t_track->history;
+    const auto  frame   = std::find_if(history.rbegin(), history.rend(), [](const ProfileEvent& e) { return e.depth == 0; });
+    if (frame == history.rend())
+        return zones;
+
+    // Children are recorded before their parent, so they sit right before the frame in the history
+    for (auto event = std::next(frame); event != history.rend() && event->depth > 0 && event->start_ns >= frame->start_ns; event++)
+    {
+        const double duration_ms = static_cast<double>(event->end_ns - event->start_ns) / 1e6;
+        const auto   zone        = std::find_if(zones.begin(), zones.end(), [&](const auto& z) { return z.first == event->name; });
+        if (zone != zones.end())
+            zone->second += duration_ms;
+        else
+            zones.emplace_back(event->name, duration_ms);
+    }
+    return zones;
+}
+
+static bool write_chrome_trace(const std::vector<std::shared_ptr<ThreadTrack>>& tracks, const std::string& file_path)
+{
+    std::ofstream out(file_path);
+    if (!out)
+    {
+        std::cerr << "Error: cannot write profile to " << file_path << '\n';
+        return false;
+    }
+
+    // Complete events ("X") in microseconds, plus one metadata event naming each thread
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    for (const auto& track : tracks)
+    {
+        out << (first ? "" : ",") << "\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << track->id << ",\"args\":{\"name\":";
+        write_json_string(out, track->name);
+        out << "}}";
+        first = false;
+
+        for (const ProfileEvent& event : track->history)
+        {
+            out << ",\n{\"ph\":\"X\",\"name\":";
+            write_json_string(out, event.name);
+            out << ",\"pid\":1,\"tid\":" << track->id
+                << ",\"ts\":" << static_cast<double>(event.start_ns) / 1e3
+                << ",\"dur\":" << static_cast<double>(event.end_ns - event.start_ns) / 1e3 << "}";
+        }
+    }
+    out << "\n]}\n";
+
+    std::cout << "Profile exported to " << file_path << std::endl;
+    return true;
+}
+
+bool Profiler::export_chrome_trace(const std::string& file_path)
+{
+    std::lock_guard lock(state().mutex);
+    return write_chrome_trace(state().tracks, file_path);
+}
+
+ProfileZone::ProfileZone(const char* name)
+    : m_name(name), m_start_ns(Profiler::now_ns()), m_depth(t_depth++)
+{
+}
+
+ProfileZone::~ProfileZone()
+{
+    t_depth--;
+    Profiler::record(m_name, m_start_ns, Profiler::now_ns(), m_depth);
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct ProfileEvent {
+    const char*   name; // Must be a string literal, only the pointer is stored
+    std::int64_t  start_ns;
+    std::int64_t  end_ns;
+    std::uint32_t depth;
+};
+
+// Fixed-size ring owned by one thread: the thread pushes, the profiler drains, without any lock.
+// When the profiler falls behind, new events are dropped rather than stalling the thread.
+class ProfileEventBuffer {
+public:
+    static constexpr std::size_t capacity = 1 << 14;
+
+    void push(const ProfileEvent& event)
+    {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) >= capacity)
+        {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        m_events[head % capacity] = event;
+        m_head.store(head + 1, std::memory_order_release);
+    }
+
+    template<typename Consumer>
+    void drain(Consumer&& consumer)
+    {
+        const std::size_t head = m_head.load(std::memory_order_acquire);
+        std::size_t       tail = m_tail.load(std::memory_order_relaxed);
+        for (; tail != head; tail++)
+        {
+            consumer(m_events[tail % capacity]);
+        }
+        m_tail.store(tail, std::memory_order_release);
+    }
+
+    std::uint64_t get_dropped_count() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    std::array<ProfileEvent, capacity> m_events;
+    alignas(64) std::atomic<std::size_t> m_head{0};
+    alignas(64) std::atomic<std::size_t> m_tail{0};
+    std::atomic<std::uint64_t> m_dropped{0};
+};
+
+// Collects the zones of every thread and shows them in an ImGui panel.
+// collect() and draw_Gui() are meant to be called once per frame from the render thread.
+class Profiler {
+public:
+    static constexpr const char* default_trace_path = "profile_trace.json";
+
+    static std::int64_t now_ns();
+
+    static void set_thread_name(const std::string& name);
+    static void record(const char* name, std::int64_t start_ns, std::int64_t end_ns, std::uint32_t depth);
+
+    static void collect();
+    static void draw_Gui();
+
+    // Time spent in each zone nested in the last complete top-level zone of the calling thread, in milliseconds, summed by name
+    static std::vector<std::pair<std::string, double>> last_frame_zones();
+
+    // Writes the recorded history in the Chrome trace event format (chrome://tracing, Perfetto)
+    static bool export_chrome_trace(const std::string& file_path);
+};
+
+// Records the time spent between its construction and its destruction
+class ProfileZone {
+public:
+    explicit ProfileZone(const char* name);
+    ~ProfileZone();
+
+    ProfileZone(const ProfileZone&)            = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char*   m_name;
+    std::int64_t  m_start_ns;
+    std::uint32_t m_depth;
+};
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b)      PROFILE_CONCAT_IMPL(a, b)
+
+#ifdef BOIDS_PROFILER
+#define PROFILE_ZONE(name) const ProfileZone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#endif
@@ -1,33 +1,100 @@
 #include "3D_model.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
 #include "3D_loader/model_loader.hpp"
+#include "3D_loader/vertex_packing.hpp"
+#include "profiling/profiler.hpp"
 
 
 Model::Model(const std::string& model_path)
 {
+    PROFILE_ZONE("Load model");
+
     // Load model from file path
     std::cout << "Loading model from: " << model_path << std::endl;
 
-    ModelLoader::Model model = ModelLoader::load_model(model_path);
+    ModelLoader::Model model        = ModelLoader::load_model(model_path);
+    const std::size_t  vertex_count = model.combined_data.size() / ModelLoader::vertex_stride;
+    std::cout << "  " << model.unindexed_vertex_count << " vertices drawn unindexed, " << vertex_count << " indexed, ACMR "
+              << model.file_order_acmr << " in file order, " << model.acmr << " optimized (3 unindexed)" << std::endl;
+
+    const PackedVertices packed = pack_vertices(model.combined_data);
+    m_position_min              = packed.position_min;
+    m_position_extent           = packed.position_extent;
+    m_normal_scale              = packed.normal_scale;
+    std::cout << "  " << vertex_format_name(packed.format) << " vertices: " << packed.data.size() << " bytes instead of "
+              << model.combined_data.size() * sizeof(float) << std::endl;
 
     m_vbo_vertices.bind();
-    m_vbo_vertices.fill(model.combined_data.data(), model.combined_data.size() * sizeof(float), GL_STATIC_DRAW);
+    m_vbo_vertices.fill(packed.data.data(), static_cast<GLsizei>(packed.data.size()), GL_STATIC_DRAW);
 
     m_vao.bind();
-    int stride = 8 * sizeof(float);
+    // The element buffer binding is stored in the VAO, it is bound while the VAO is
+    m_ibo.bind();
+    m_index_count = static_cast<GLsizei>(model.indices.size());
+    if (vertex_count <= std::numeric_limits<std::uint16_t>::max())
+    {
+        const std::vector<std::uint16_t> short_indices(model.indices.begin(), model.indices.end());
+        m_ibo.fill(short_indices.data(), static_cast<GLsizeiptr>(short_indices.size() * sizeof(std::uint16_t)), GL_STATIC_DRAW);
+        m_index_type = GL_UNSIGNED_SHORT;
+    }
+    else
+    {
+        m_ibo.fill(model.indices.data(), static_cast<GLsizeiptr>(model.indices.size() * sizeof(std::uint32_t)), GL_STATIC_DRAW);
+        m_index_type = GL_UNSIGNED_INT;
+    }
 
-    m_vao.specify_attribute(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);                   // Position attribute
-    m_vao.specify_attribute(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float))); // Normal attribute
-    m_vao.specify_attribute(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float))); // Texture coordinate attribute
+    const GLsizei stride = static_cast<GLsizei>(vertex_format_stride(packed.format));
+    switch (packed.format)
+    {
+    case VertexFormat::Float:
+        m_vao.specify_attribute(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);                   // Position attribute
+        m_vao.specify_attribute(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float))); // Normal attribute
+        m_vao.specify_attribute(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float))); // Texture coordinate attribute
+        break;
+    case VertexFormat::Compact16:
+        // Normals are read as integers and scaled by the shader, the normalization of signed integers changed with GL 4.2
+        m_vao.specify_attribute(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)0); // Position in the bounds
+        m_vao.specify_attribute(1, 2, GL_SHORT, GL_FALSE, stride, (void*)8);         // Octahedral normal
+        m_vao.specify_attribute(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)12);   // Texture coordinates
+        break;
+    case VertexFormat::Compact8:
+        m_vao.specify_attribute(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)0); // Position in the bounds
+        m_vao.specify_attribute(1, 2, GL_BYTE, GL_FALSE, stride, (void*)6);          // Octahedral normal
+        m_vao.specify_attribute(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)8);    // Texture coordinates
+        break;
+    }
     m_vao.unbind();
 
     m_vbo_vertices.unbind();
+}
 
-    // Store the data size for use in glDrawArrays
-    m_data_size = model.combined_data.size() / 8;
+void Model::draw(GLsizei copies) const
+{
+    // The VAO stays bound, the next draw of this model does not bind it again
+    m_vao.bind();
+    if (copies == 1)
+        glDrawElements(GL_TRIANGLES, m_index_count, m_index_type, nullptr);
+    else
+        glDrawElementsInstanced(GL_TRIANGLES, m_index_count, m_index_type, nullptr, copies);
 }
 
-void Model::draw() const {
+void Model::draw_instances(const InstanceBuffer& instances, std::size_t first, std::size_t count, GLuint copies)
+{
+    if (count == 0)
+        return;
+
+    // The attributes point at the range, so each frame and each object can use another part of the buffer
+    const GLintptr start = instances.offset_of(first);
     m_vao.bind();
-    glDrawArrays(GL_TRIANGLES, 0, m_data_size);
-    m_vao.unbind();
+    instances.bind();
+    m_vao.specify_instance_attribute(3, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(start + offsetof(InstanceData, position)), copies); // Position and scale
+    m_vao.specify_instance_attribute(4, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(start + offsetof(InstanceData, color)), copies);    // Color
+    glDrawElementsInstanced(GL_TRIANGLES, m_index_count, m_index_type, nullptr, static_cast<GLsizei>(count * copies));
+    // The VAO must not keep pointing at the buffer of the instances once they are drawn
+    m_vao.disable_attribute(3);
+    m_vao.disable_attribute(4);
+    instances.unbind();
 }
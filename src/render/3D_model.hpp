@@ -1,18 +1,33 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include "ibo.hpp"
+#include "instance_buffer.hpp"
 #include "vao.hpp"
 #include "vbo.hpp"
 
 class Model {
 private:
-    int m_data_size;
-    VAO m_vao;
-    VBO m_vbo_vertices;
+    GLsizei m_index_count;
+    GLenum  m_index_type; // 16-bit indices when the mesh has few enough vertices
+    VAO     m_vao;
+    VBO     m_vbo_vertices;
+    IBO     m_ibo;
+
+    // Decoding of the quantized vertices, see 3D_loader/vertex_packing.hpp
+    glm::vec3 m_position_min{0.f};
+    glm::vec3 m_position_extent{1.f};
+    float     m_normal_scale = 0.f;
 
 public:
     Model(const std::string& model_path);
     
-    VAO get_VAO() const { return m_vao; }
-    void draw() const;
+    const VAO& get_VAO() const { return m_vao; }
+    glm::vec3  get_position_min() const { return m_position_min; }
+    glm::vec3  get_position_extent() const { return m_position_extent; }
+    float      get_normal_scale() const { return m_normal_scale; }
+    // copies draws of the mesh in one call, told apart by gl_InstanceID
+    void draw(GLsizei copies = 1) const;
+    // copies per instance of the range in a single draw call, the consecutive copies of an instance share its attributes
+    void draw_instances(const InstanceBuffer& instances, std::size_t first, std::size_t count, GLuint copies = 1);
 };
\ No newline at end of file
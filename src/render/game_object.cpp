@@ -1,5 +1,6 @@
 #include "game_object.hpp"
 #include <glm/gtc/matrix_transform.hpp>
+#include "gl_state.hpp"
 #include "texture_manager.hpp"
 
 GameObject::GameObject(const std::string& model_path, const std::string& texture_path)
@@ -42,9 +43,9 @@ void GameObject::set_lighting_factors(const glm::vec3& new_diffuse, const glm::v
     m_shininess_factor = new_shininess;
 }
 
-void GameObject::draw() const
+void GameObject::draw(GLsizei copies) const
 {
-    m_3D_model.draw();
+    m_3D_model.draw(copies);
 }
 
 void GameObject::load_texture(const std::string& texture_path)
@@ -114,31 +115,36 @@ void GameObject::setup_matrices(Program& program, const glm::mat4& view_matrix,
     glm::mat3 normal_matrix = glm::transpose(glm::inverse(glm::mat3(MV_matrix)));
     glm::mat4 MVP_matrix    = proj_matrix * MV_matrix;
 
-    glUniformMatrix4fv(program.u_MVP_matrix, 1, GL_FALSE, glm::value_ptr(MVP_matrix));
-    glUniformMatrix4fv(program.u_MV_matrix, 1, GL_FALSE, glm::value_ptr(MV_matrix));
-    glUniformMatrix3fv(program.u_normal_matrix, 1, GL_FALSE, glm::value_ptr(normal_matrix));
+    GLState::uniform(program.u_MVP_matrix, MVP_matrix);
+    GLState::uniform(program.u_MV_matrix, MV_matrix);
+    GLState::uniform(program.u_normal_matrix, normal_matrix);
 }
 
 void GameObject::setup_shader(Program& program, const glm::vec3& kd, const glm::vec3& ks, float shininess, const glm::vec3& color, bool use_texture)
 {
-    glUniform3fv(program.u_kd, 1, glm::value_ptr(kd));
-    glUniform3fv(program.u_ks, 1, glm::value_ptr(ks));
-    glUniform1f(program.u_shininess, shininess);
+    // How the vertices of the mesh are quantized
+    GLState::uniform(program.u_position_min, m_3D_model.get_position_min());
+    GLState::uniform(program.u_position_extent, m_3D_model.get_position_extent());
+    GLState::uniform(program.u_normal_scale, m_3D_model.get_normal_scale());
+
+    GLState::uniform(program.u_kd, kd);
+    GLState::uniform(program.u_ks, ks);
+    GLState::uniform(program.u_shininess, shininess);
 
     if (use_texture && this->get_use_texture())
     {
-        glUniform1i(program.u_texture, 0); // Bind texture unit 0
-        glBindTexture(GL_TEXTURE_2D, this->get_texture());
-        glUniform1i(program.u_use_color, 0); // Signal to use texture
+        GLState::uniform(program.u_texture, 0); // Bind texture unit 0
+        TextureManager::bind_texture(this->get_texture(), 0);
+        GLState::uniform(program.u_use_color, 0); // Signal to use texture
     }
     else
     {
-        glUniform1i(program.u_use_color, 1);                     // Signal to use color
-        glUniform3fv(program.u_color, 1, glm::value_ptr(color)); // Send the color to the shader
+        GLState::uniform(program.u_use_color, 1); // Signal to use color
+        GLState::uniform(program.u_color, color); // Send the color to the shader
     }
 }
 
-void GameObject::render_game_object(Program& program, const glm::mat4& view_matrix, const glm::mat4& proj_matrix)
+void GameObject::render_game_object(Program& program, const glm::mat4& view_matrix, const glm::mat4& proj_matrix, float outline_scale)
 {
     // glCullFace(GL_BACK);
 
@@ -152,21 +158,61 @@ void GameObject::render_game_object(Program& program, const glm::mat4& view_matr
     float     shininess = this->get_shininess_factor();
     setup_shader(program, diffuse, specular, shininess, this->get_base_color(), true);
 
-    this->draw();
+    // The outline is the second copy, it needs the projection apart from the model-view matrix to be pushed back
+    GLState::uniform(program.u_outline_scale, outline_scale);
+    if (outline_scale > 0.0f)
+        GLState::uniform(program.u_proj_matrix, proj_matrix);
+    this->draw(outline_scale > 0.0f ? 2 : 1);
+}
+
+void GameObject::setup_instance_matrices(Program& program, const glm::mat4& view_matrix, const glm::mat4& proj_matrix, const glm::mat4& model_matrix)
+{
+    // The translation comes from each instance, only the rotation and scale of the object are shared
+    glm::mat4 shared_model = model_matrix;
+    shared_model[3]        = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+    glm::mat4 MV_matrix     = view_matrix * shared_model;
+    glm::mat3 normal_matrix = glm::transpose(glm::inverse(glm::mat3(MV_matrix)));
+    GLState::uniform(program.u_MV_matrix, MV_matrix);
+    GLState::uniform(program.u_normal_matrix, normal_matrix);
+    GLState::uniform(program.u_view_matrix, view_matrix);
+    GLState::uniform(program.u_proj_matrix, proj_matrix);
 }
 
-void GameObject::render_edge(Program& program, const glm::mat4& view_matrix, const glm::mat4& proj_matrix, const float scale_factor)
+void GameObject::draw_instances(Program& program, const InstanceBuffer& instances, std::size_t first, std::size_t count, float outline_scale)
 {
-    // glCullFace(GL_FRONT);
+    GLState::uniform(program.u_instanced, 1);
+    GLState::uniform(program.u_outline_scale, outline_scale);
+    m_3D_model.draw_instances(instances, first, count, outline_scale > 0.0f ? 2 : 1);
+    // The other renders do not set it
+    GLState::uniform(program.u_instanced, 0);
+}
 
+void GameObject::render_instances(Program& program, const glm::mat4& view_matrix, const glm::mat4& proj_matrix, const InstanceBuffer& instances, std::size_t first, std::size_t count, float outline_scale)
+{
     program.use();
+    setup_instance_matrices(program, view_matrix, proj_matrix, this->get_model_matrix());
+    setup_shader(program, this->get_diffuse_factor(), this->get_specular_factor(), this->get_shininess_factor(), this->get_base_color(), true);
+    draw_instances(program, instances, first, count, outline_scale);
+}
 
-    glm::mat4 model_matrix = glm::scale(this->get_model_matrix(), {scale_factor, scale_factor, scale_factor});
-    setup_matrices(program, view_matrix, proj_matrix, model_matrix);
+float GameObject::view_depth(const glm::mat4& view_matrix) const
+{
+    return -(view_matrix * glm::vec4(m_position, 1.0f)).z;
+}
 
-    glm::vec3 white(1.0f, 1.0f, 1.0f);
-    glm::vec3 black(0.0f, 0.0f, 0.0f);
-    setup_shader(program, white, white, 0.0f, black, false);
+void GameObject::submit(RenderQueue& queue, RenderPass pass, Program& program, const glm::mat4& view_matrix, float outline_scale)
+{
+    const GLuint texture = this->get_use_texture() ? this->get_texture() : 0;
+    queue.submit(RenderQueue::make_key(pass, program.get_id(), this->get_mesh_id(), texture, view_depth(view_matrix)), {this, &program, DrawKind::Object, outline_scale});
+}
 
-    this->draw();
-}
\ No newline at end of file
+void GameObject::submit_instances(RenderQueue& queue, Program& program, const InstanceBuffer& instances, std::size_t first, std::size_t count, float outline_scale)
+{
+    if (count == 0)
+        return;
+    // The copies are spread around the scene, they go first in their mesh and texture
+    const GLuint texture = this->get_use_texture() ? this->get_texture() : 0;
+    queue.submit(RenderQueue::make_key(RenderPass::FrontFaces, program.get_id(), this->get_mesh_id(), texture, 0.0f),
+                 {this, &program, DrawKind::Instances, outline_scale, &instances, first, count});
+}
@@ -5,6 +5,7 @@
 #include "3D_model.hpp"
 #include "glm/gtc/type_ptr.hpp"
 #include "program.hpp"
+#include "render_queue.hpp"
 
 class GameObject {
 private:
@@ -23,6 +24,9 @@ private:
     float     m_shininess_factor; // Shininess for specular highlight
 
     void setup_matrices(Program& program, const glm::mat4& view_matrix, const glm::mat4& proj_matrix, const glm::mat4& model_matrix);
+    void setup_instance_matrices(Program& program, const glm::mat4& view_matrix, const glm::mat4& proj_matrix, const glm::mat4& model_matrix);
+    void draw_instances(Program& program, const InstanceBuffer& instances, std::size_t first, std::size_t count, float outline_scale);
+    float view_depth(const glm::mat4& view_matrix) const;
     void setup_shader(Program& program, const glm::vec3& kd, const glm::vec3& ks, float shininess, const glm::vec3& color, bool use_texture);
 
 public:
@@ -42,6 +46,7 @@ public:
 
     glm::vec3 get_base_color() const { return m_base_color; }
     GLuint    get_texture() const { return m_texture_object; }
+    GLuint    get_mesh_id() const { return m_3D_model.get_VAO().get_id(); }
     bool      get_use_texture() const { return m_use_texture; }
 
     glm::vec3 get_position() const { return m_position; }
@@ -60,8 +65,16 @@ public:
 
     void interpolate_material_factors(const glm::vec3& target_diffuse, const glm::vec3& target_specular, float target_shininess, float blend_factor);
 
-    void render_game_object(Program& program, const glm::mat4& view_matrix, const glm::mat4& proj_matrix);
-    void render_edge(Program& program, const glm::mat4& view_matrix, const glm::mat4& proj_matrix, const float scale_factor);
+    // Above 0, outline_scale draws the outline in the same call: a black copy grown by that factor, see 3D.vs.glsl
+    void render_game_object(Program& program, const glm::mat4& view_matrix, const glm::mat4& proj_matrix, float outline_scale = 0.0f);
 
-    void draw() const;
+    // Same renders for count copies of the object from instance first, in one draw call. Copies share the rotation and
+    // scale of the object, each instance gives its position, an extra scale and, when the object has no texture, its color.
+    void render_instances(Program& program, const glm::mat4& view_matrix, const glm::mat4& proj_matrix, const InstanceBuffer& instances, std::size_t first, std::size_t count, float outline_scale = 0.0f);
+
+    // Same renders, queued to be drawn once the queue is sorted. Objects are ordered in their pass by the view matrix.
+    void submit(RenderQueue& queue, RenderPass pass, Program& program, const glm::mat4& view_matrix, float outline_scale = 0.0f);
+    void submit_instances(RenderQueue& queue, Program& program, const InstanceBuffer& instances, std::size_t first, std::size_t count, float outline_scale = 0.0f);
+
+    void draw(GLsizei copies = 1) const;
 };
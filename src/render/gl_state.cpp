@@ -0,0 +1,217 @@
+#include "gl_state.hpp"
+#include <array>
+#include <cstring>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "glm/gtc/type_ptr.hpp"
+
+// Last value sent to a uniform location, compared byte for byte
+struct UniformValue {
+    std::array<float, 16> data{};
+    std::size_t           size = 0; // In floats, 0 until the location is set once
+};
+
+struct GLStateCache {
+    std::optional<GLuint>                                          program;
+    std::optional<GLuint>                                          vertex_array;
+    std::optional<GLuint>                                          active_texture_unit;
+    std::array<std::optional<GLuint>, GLState::texture_unit_count> textures;
+    std::optional<bool>                                            cull_face_enabled;
+    std::optional<GLenum>                                          cull_face_mode;
+
+    // Uniforms belong to the program, they survive program switches and begin_frame()
+    std::unordered_map<GLuint, std::vector<UniformValue>> uniforms;
+    std::vector<UniformValue>*                            current_uniforms = nullptr;
+
+    std::uint64_t issued_calls      = 0;
+    std::uint64_t saved_calls       = 0;
+    std::uint64_t last_issued_calls = 0;
+    std::uint64_t last_saved_calls  = 0;
+};
+
+static GLStateCache& state()
+{
+    static GLStateCache cache;
+    return cache;
+}
+
+// Records the new value and returns true when it differs from the cached one
+template<typename T>
+static bool changes(std::optional<T>& cached, T value)
+{
+    GLStateCache& cache = state();
+    if (cached == value)
+    {
+        cache.saved_calls++;
+        return false;
+    }
+    cached = value;
+    cache.issued_calls++;
+    return true;
+}
+
+static bool uniform_changes(GLint location, const float* data, std::size_t size)
+{
+    GLStateCache& cache = state();
+    if (location < 0)
+    {
+        // Inactive uniforms are ignored by the GL
+        cache.saved_calls++;
+        return false;
+    }
+    if (cache.current_uniforms == nullptr)
+    {
+        // The program was not set through the cache, its uniforms are unknown
+        cache.issued_calls++;
+        return true;
+    }
+
+    std::vector<UniformValue>& values = *cache.current_uniforms;
+    if (static_cast<std::size_t>(location) >= values.size())
+        values.resize(static_cast<std::size_t>(location) + 1);
+    UniformValue& cached = values[static_cast<std::size_t>(location)];
+    if (cached.size == size && std::memcmp(cached.data.data(), data, size * sizeof(float)) == 0)
+    {
+        cache.saved_calls++;
+        return false;
+    }
+    std::memcpy(cached.data.data(), data, size * sizeof(float));
+    cached.size = size;
+    cache.issued_calls++;
+    return true;
+}
+
+void GLState::begin_frame()
+{
+    GLStateCache& cache     = state();
+    cache.last_issued_calls = cache.issued_calls;
+    cache.last_saved_calls  = cache.saved_calls;
+    cache.issued_calls      = 0;
+    cache.saved_calls       = 0;
+    invalidate();
+}
+
+void GLState::invalidate()
+{
+    GLStateCache& cache       = state();
+    cache.program             = std::nullopt;
+    cache.vertex_array        = std::nullopt;
+    cache.active_texture_unit = std::nullopt;
+    cache.textures.fill(std::nullopt);
+    cache.cull_face_enabled = std::nullopt;
+    cache.cull_face_mode    = std::nullopt;
+    cache.current_uniforms  = nullptr;
+}
+
+void GLState::use_program(GLuint program)
+{
+    GLStateCache& cache = state();
+    if (changes(cache.program, program))
+        glUseProgram(program);
+    cache.current_uniforms = program != 0 ? &cache.uniforms[program] : nullptr;
+}
+
+void GLState::bind_vertex_array(GLuint vertex_array)
+{
+    if (changes(state().vertex_array, vertex_array))
+        glBindVertexArray(vertex_array);
+}
+
+void GLState::bind_texture(GLuint texture_unit, GLuint texture)
+{
+    GLStateCache& cache = state();
+    if (texture_unit < texture_unit_count && !changes(cache.textures[texture_unit], texture))
+        return;
+    if (texture_unit >= texture_unit_count)
+        cache.issued_calls++;
+    if (changes(cache.active_texture_unit, texture_unit))
+        glActiveTexture(GL_TEXTURE0 + texture_unit);
+    glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+void GLState::enable_cull_face(bool enabled)
+{
+    if (!changes(state().cull_face_enabled, enabled))
+        return;
+    if (enabled)
+        glEnable(GL_CULL_FACE);
+    else
+        glDisable(GL_CULL_FACE);
+}
+
+void GLState::cull_face(GLenum mode)
+{
+    if (changes(state().cull_face_mode, mode))
+        glCullFace(mode);
+}
+
+void GLState::uniform(GLint location, int value)
+{
+    // Stored with the bits of the integer, so that the comparison stays exact
+    float bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    if (uniform_changes(location, &bits, 1))
+        glUniform1i(location, value);
+}
+
+void GLState::uniform(GLint location, float value)
+{
+    if (uniform_changes(location, &value, 1))
+        glUniform1f(location, value);
+}
+
+void GLState::uniform(GLint location, const glm::vec3& value)
+{
+    if (uniform_changes(location, glm::value_ptr(value), 3))
+        glUniform3fv(location, 1, glm::value_ptr(value));
+}
+
+void GLState::uniform(GLint location, const glm::mat3& value)
+{
+    if (uniform_changes(location, glm::value_ptr(value), 9))
+        glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void GLState::uniform(GLint location, const glm::mat4& value)
+{
+    if (uniform_changes(location, glm::value_ptr(value), 16))
+        glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void GLState::forget_program(GLuint program)
+{
+    GLStateCache& cache = state();
+    if (cache.program == program)
+    {
+        cache.program          = 0;
+        cache.current_uniforms = nullptr;
+    }
+    cache.uniforms.erase(program);
+}
+
+void GLState::forget_vertex_array(GLuint vertex_array)
+{
+    GLStateCache& cache = state();
+    if (cache.vertex_array == vertex_array)
+        cache.vertex_array = 0;
+}
+
+std::uint64_t GLState::get_issued_calls()
+{
+    return state().last_issued_calls;
+}
+
+std::uint64_t GLState::get_saved_calls()
+{
+    return state().last_saved_calls;
+}
+
+void GLState::draw_Gui()
+{
+    const std::uint64_t issued = get_issued_calls();
+    const std::uint64_t saved  = get_saved_calls();
+    const std::uint64_t total  = issued + saved;
+    ImGui::Text("GL state: %llu calls saved, %llu issued (%.0f%% redundant)", static_cast<unsigned long long>(saved),
+                static_cast<unsigned long long>(issued), total > 0 ? 100. * static_cast<double>(saved) / static_cast<double>(total) : 0.);
+}
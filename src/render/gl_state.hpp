@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "p6/p6.h"
+
+// Shadow copy of the GL state the renderer changes between draws: program, vertex array, textures, face culling and
+// the uniforms of the current program. A call whose value is already set is not sent to the driver.
+// The GL state is changed behind this cache by p6 and ImGui, so begin_frame() forgets it before the frame draws.
+class GLState {
+public:
+    static constexpr GLuint texture_unit_count = 8;
+
+    static void begin_frame();
+    static void invalidate();
+
+    static void use_program(GLuint program);
+    static void bind_vertex_array(GLuint vertex_array);
+    static void bind_texture(GLuint texture_unit, GLuint texture);
+    static void enable_cull_face(bool enabled);
+    static void cull_face(GLenum mode);
+
+    // Set the uniforms of the program in use
+    static void uniform(GLint location, int value);
+    static void uniform(GLint location, float value);
+    static void uniform(GLint location, const glm::vec3& value);
+    static void uniform(GLint location, const glm::mat3& value);
+    static void uniform(GLint location, const glm::mat4& value);
+
+    // Objects about to be deleted, the GL falls back to 0 when they are bound
+    static void forget_program(GLuint program);
+    static void forget_vertex_array(GLuint vertex_array);
+
+    // Calls of the last complete frame
+    static std::uint64_t get_issued_calls();
+    static std::uint64_t get_saved_calls();
+
+    static void draw_Gui();
+};
@@ -0,0 +1,26 @@
+#include "ibo.hpp"
+
+IBO::IBO()
+{
+    glGenBuffers(1, &id);
+}
+
+IBO::~IBO()
+{
+    glDeleteBuffers(1, &id);
+}
+
+void IBO::bind() const
+{
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, id);
+}
+
+void IBO::unbind() const
+{
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void IBO::fill(const void* data, GLsizeiptr size, GLenum usage)
+{
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, data, usage);
+}
\ No newline at end of file
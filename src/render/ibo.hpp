@@ -0,0 +1,17 @@
+#pragma once
+
+#include "p6/p6.h"
+
+// Element array buffer, the binding is part of the VAO bound at the time
+class IBO {
+public:
+    IBO();
+    ~IBO();
+
+    void bind() const;
+    void unbind() const;
+    void fill(const void* data, GLsizeiptr size, GLenum usage);
+
+private:
+    GLuint id;
+};
@@ -0,0 +1,7 @@
+#include "instance_buffer.hpp"
+
+std::span<InstanceData> InstanceBuffer::begin_frame(std::size_t count)
+{
+    const std::span<std::byte> memory = m_stream.begin_writing(count * sizeof(InstanceData));
+    return {reinterpret_cast<InstanceData*>(memory.data()), memory.size() / sizeof(InstanceData)};
+}
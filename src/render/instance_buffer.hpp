@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include "glm/glm.hpp"
+#include "p6/p6.h"
+#include "streaming_buffer.hpp"
+
+// Per-instance attributes of GameObject::render_instances, read at locations 3 and 4 by 3D.vs.glsl
+struct InstanceData {
+    glm::vec3 position;
+    float     scale = 1.f; // Over the scale of the object
+    glm::vec3 color;       // Replaces the color of objects without texture
+};
+
+// Copies of objects drawn in a single call each, written once per frame straight into GPU-visible memory.
+// Several objects can share the buffer, each drawing its own range of the instances.
+class InstanceBuffer {
+public:
+    // Room for count instances, write-only: fill every one of them, then call end_writing() before drawing
+    std::span<InstanceData> begin_frame(std::size_t count);
+    void                    end_writing() { m_stream.end_writing(); }
+    // Once the draws of the frame are issued
+    void end_frame() { m_stream.end_frame(); }
+
+    void bind() const { m_stream.bind(); }
+    void unbind() const { m_stream.unbind(); }
+
+    // Where instance first of this frame starts in the buffer
+    GLintptr offset_of(std::size_t first) const { return m_stream.get_offset() + static_cast<GLintptr>(first * sizeof(InstanceData)); }
+
+    const StreamingBuffer& get_stream() const { return m_stream; }
+
+private:
+    StreamingBuffer m_stream;
+};
@@ -1,6 +1,13 @@
 #include "program.hpp"
+#include "gl_state.hpp"
+
+Program::~Program()
+{
+    // p6 deletes the program, a new one could get its name
+    GLState::forget_program(m_program.id());
+}
 
 void Program::use() const
 {
-    m_program.use();
+    GLState::use_program(m_program.id());
 }
@@ -10,6 +10,14 @@ public:
     GLint u_MVP_matrix;
     GLint u_MV_matrix;
     GLint u_normal_matrix;
+    GLint u_view_matrix;
+    GLint u_proj_matrix;
+    GLint u_instanced;
+    GLint u_outline_scale;
+
+    GLint u_position_min;
+    GLint u_position_extent;
+    GLint u_normal_scale;
 
     GLint u_texture;
     GLint u_color;
@@ -32,6 +40,13 @@ public:
         , u_MVP_matrix(glGetUniformLocation(m_program.id(), "u_MVP_matrix"))
         , u_MV_matrix(glGetUniformLocation(m_program.id(), "u_MV_matrix"))
         , u_normal_matrix(glGetUniformLocation(m_program.id(), "u_normal_matrix"))
+        , u_view_matrix(glGetUniformLocation(m_program.id(), "u_view_matrix"))
+        , u_proj_matrix(glGetUniformLocation(m_program.id(), "u_proj_matrix"))
+        , u_instanced(glGetUniformLocation(m_program.id(), "u_instanced"))
+        , u_outline_scale(glGetUniformLocation(m_program.id(), "u_outline_scale"))
+        , u_position_min(glGetUniformLocation(m_program.id(), "u_position_min"))
+        , u_position_extent(glGetUniformLocation(m_program.id(), "u_position_extent"))
+        , u_normal_scale(glGetUniformLocation(m_program.id(), "u_normal_scale"))
         , u_texture(glGetUniformLocation(m_program.id(), "u_texture"))
         , u_color(glGetUniformLocation(m_program.id(), "u_color"))
         , u_use_color(glGetUniformLocation(m_program.id(), "u_use_color"))
@@ -46,5 +61,8 @@ public:
     {
     }
 
-    void use() const;
+    ~Program();
+
+    GLuint get_id() const { return m_program.id(); }
+    void   use() const;
 };
@@ -0,0 +1,156 @@
+#include "quality_controller.hpp"
+#include <algorithm>
+#include <limits>
+#include "p6/p6.h"
+
+static constexpr std::size_t all_boids = std::numeric_limits<std::size_t>::max();
+
+// From best to cheapest: stars switch to the low-poly mesh closer and closer, then the simulation samples its
+// neighbors, then only the nearest boids are drawn
+static constexpr std::array<QualityLevel, QualityController::level_count> levels{{
+    {std::numeric_limits<float>::infinity(), all_boids, 0},
+    {12.f, all_boids, 0},
+    {8.f, all_boids, 1},
+    {5.f, 50000, 1},
+    {3.f, 20000, 2},
+    {0.f, 5000, 2},
+}};
+
+bool QualityController::add_frame(double frame_ms)
+{
+    constexpr double smoothing = 0.1;
+
+    m_frame++;
+    m_smoothed_ms = m_frame == 1 ? frame_ms : m_smoothed_ms + smoothing * (frame_ms - m_smoothed_ms);
+    if (!m_enabled || m_frozen)
+        return false;
+
+    const double degrade_ms = m_target_ms * degrade_ratio;
+    const double improve_ms = m_target_ms * improve_ratio;
+    m_over_count            = m_smoothed_ms > degrade_ms ? m_over_count + 1 : 0;
+    m_under_count           = m_smoothed_ms < improve_ms ? m_under_count + 1 : 0;
+
+    if (m_over_count >= degrade_frames && m_level + 1 < level_count)
+    {
+        // A level that was just improved to and could not hold the budget is tried less eagerly next time
+        if (m_improved && m_frame - m_last_improve_frame < 4 * static_cast<std::uint64_t>(improve_frames))
+            m_backoff[m_level] = std::min(m_backoff[m_level] + 1, max_backoff);
+        m_improved = false;
+        change_level(m_level + 1, degrade_ms);
+        return true;
+    }
+    if (m_level > 0 && m_under_count >= (improve_frames << m_backoff[m_level - 1]))
+    {
+        m_improved           = true;
+        m_last_improve_frame = m_frame;
+        change_level(m_level - 1, improve_ms);
+        return true;
+    }
+    return false;
+}
+
+void QualityController::change_level(std::size_t level, double threshold_ms)
+{
+    m_decisions[m_decision_total % decision_count] = {m_frame, m_smoothed_ms, threshold_ms, m_level, level};
+    m_decision_total++;
+
+    // The counters start over, so the next change waits for the new level to show its own frame times
+    m_level       = level;
+    m_over_count  = 0;
+    m_under_count = 0;
+}
+
+void QualityController::freeze_at(std::size_t level)
+{
+    m_frozen = true;
+    m_level  = std::min(level, level_count - 1);
+}
+
+const QualityLevel& QualityController::get_level() const
+{
+    return levels[get_level_index()];
+}
+
+std::size_t QualityController::get_level_index() const
+{
+    return m_enabled || m_frozen ? m_level : 0;
+}
+
+BoidVariables QualityController::apply_simulation_tier(BoidVariables variables) const
+{
+    const int tier = get_level().simulation_tier;
+    if (tier >= 1)
+    {
+        variables.sample_neighbors = true;
+        variables.sample_size      = std::min(variables.sample_size, 16);
+    }
+    if (tier >= 2)
+    {
+        variables.sample_size   = std::min(variables.sample_size, 8);
+        variables.max_neighbors = std::min(variables.max_neighbors, 32);
+    }
+    return variables;
+}
+
+void QualityController::select_visible(std::span<const float> squared_distances, std::vector<std::uint32_t>& visible) const
+{
+    const std::size_t count = squared_distances.size();
+    const std::size_t cap   = get_level().visible_cap;
+    visible.resize(std::min(count, cap));
+    if (count <= cap)
+    {
+        for (std::size_t i = 0; i < count; i++)
+        {
+            visible[i] = static_cast<std::uint32_t>(i);
+        }
+        return;
+    }
+
+    m_by_distance.resize(count);
+    for (std::size_t i = 0; i < count; i++)
+    {
+        m_by_distance[i] = {squared_distances[i], static_cast<std::uint32_t>(i)};
+    }
+    std::nth_element(m_by_distance.begin(), m_by_distance.begin() + static_cast<std::ptrdiff_t>(cap), m_by_distance.end());
+    for (std::size_t i = 0; i < cap; i++)
+    {
+        visible[i] = m_by_distance[i].second;
+    }
+}
+
+bool QualityController::draw_Gui()
+{
+    if (m_frozen)
+    {
+        ImGui::Text("Quality level %zu / %zu, frozen", m_level, level_count - 1);
+        return false;
+    }
+    const bool toggled = ImGui::Checkbox("Adaptive quality", &m_enabled);
+    if (toggled)
+    {
+        m_level       = 0;
+        m_over_count  = 0;
+        m_under_count = 0;
+        m_improved    = false;
+        m_backoff     = {};
+    }
+    if (!m_enabled)
+        return toggled;
+
+    ImGui::SliderFloat("Frame budget (ms)", &m_target_ms, 4.f, 50.f);
+    const QualityLevel& level = get_level();
+    ImGui::Text("Frame: %.2f ms smoothed, quality level %zu / %zu", m_smoothed_ms, m_level, level_count - 1);
+    if (level.visible_cap == all_boids)
+        ImGui::Text("Low poly beyond %.1f, every boid drawn, simulation tier %d", level.lod_distance, level.simulation_tier);
+    else
+        ImGui::Text("Low poly beyond %.1f, nearest %zu boids drawn, simulation tier %d", level.lod_distance, level.visible_cap, level.simulation_tier);
+
+    // Newest decision first
+    for (std::size_t i = 0; i < std::min(m_decision_total, decision_count); i++)
+    {
+        const Decision& decision = m_decisions[(m_decision_total - 1 - i) % decision_count];
+        ImGui::Text("Frame %llu: %.2f ms %s %.2f ms, level %zu -> %zu", static_cast<unsigned long long>(decision.frame), decision.smoothed_ms,
+                    decision.to_level > decision.from_level ? "over" : "under", decision.threshold_ms, decision.from_level, decision.to_level);
+    }
+    return toggled;
+}
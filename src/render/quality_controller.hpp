@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+#include "scene_objects/boid.hpp"
+
+// What the renderer and the simulation are allowed to spend at one step of the quality ladder
+struct QualityLevel {
+    float       lod_distance;    // Stars farther than this from the camera use the low-poly mesh
+    std::size_t visible_cap;     // Only the nearest boids are drawn
+    int         simulation_tier; // 0: the GUI settings, 1: neighbor sampling, 2: smaller samples and fewer neighbors
+};
+
+// Watches the frame time and moves along a ladder of quality levels to hold a budget.
+// Hysteresis keeps it from oscillating: it degrades quickly when the smoothed time goes over the budget, but only
+// improves after a long stretch well under it, and waits twice as long each time a better level turned out too slow.
+class QualityController {
+public:
+    static constexpr std::size_t level_count    = 6;
+    static constexpr std::size_t decision_count = 8;
+
+    static constexpr float degrade_ratio  = 1.05f; // Over target * degrade_ratio for degrade_frames, the level drops
+    static constexpr float improve_ratio  = 0.7f;  // Under target * improve_ratio for improve_frames, the level rises
+    static constexpr int   degrade_frames = 15;
+    static constexpr int   improve_frames = 120;
+    static constexpr int   max_backoff    = 4; // improve_frames is doubled at most this many times
+
+    // Frame time of the CPU work of the frame. Returns true when the level changed.
+    bool add_frame(double frame_ms);
+
+    // Holds level whatever the frame times, for replays to draw and simulate as the recording did
+    void freeze_at(std::size_t level);
+
+    const QualityLevel& get_level() const;
+    std::size_t         get_level_index() const; // 0 when the controller is off
+
+    // Variables for the simulation at the current level, the GUI ones when the controller is off
+    BoidVariables apply_simulation_tier(BoidVariables variables) const;
+
+    // Indices of the boids to draw, the nearest ones when there are more than the visible cap.
+    // squared_distances are those from the camera, see compute_view_distances().
+    void select_visible(std::span<const float> squared_distances, std::vector<std::uint32_t>& visible) const;
+
+    // Returns true when the controller was turned on or off
+    bool draw_Gui();
+
+private:
+    struct Decision {
+        std::uint64_t frame;
+        double        smoothed_ms;
+        double        threshold_ms;
+        std::size_t   from_level;
+        std::size_t   to_level;
+    };
+
+    bool          m_enabled            = false;
+    bool          m_frozen             = false;
+    float         m_target_ms          = 16.6f;
+    double        m_smoothed_ms        = 0.;
+    std::size_t   m_level              = 0;
+    int           m_over_count         = 0; // Consecutive frames over the degrade threshold
+    int           m_under_count        = 0; // Consecutive frames under the improve threshold
+    bool          m_improved           = false; // The current level was reached by improving
+    std::uint64_t m_frame              = 0;
+    std::uint64_t m_last_improve_frame = 0;
+
+    std::array<int, level_count>         m_backoff{}; // Times each level could not hold the budget, see max_backoff
+    std::array<Decision, decision_count> m_decisions{};
+    std::size_t                          m_decision_total = 0;
+
+    mutable std::vector<std::pair<float, std::uint32_t>> m_by_distance; // Scratch of select_visible()
+
+    void change_level(std::size_t level, double threshold_ms);
+};
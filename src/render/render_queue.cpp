@@ -0,0 +1,120 @@
+#include "render_queue.hpp"
+#include <algorithm>
+#include <array>
+#include "game_object.hpp"
+#include "gl_state.hpp"
+#include "profiling/profiler.hpp"
+
+static constexpr unsigned pass_bits    = 2;
+static constexpr unsigned program_bits = 10;
+static constexpr unsigned mesh_bits    = 16;
+static constexpr unsigned texture_bits = 12;
+static constexpr unsigned depth_bits   = 24;
+static_assert(pass_bits + program_bits + mesh_bits + texture_bits + depth_bits == 64);
+
+static constexpr std::uint64_t field(std::uint64_t value, unsigned bits)
+{
+    return value & ((std::uint64_t{1} << bits) - 1);
+}
+
+std::uint64_t RenderQueue::make_key(RenderPass pass, GLuint program, GLuint mesh, GLuint texture, float depth)
+{
+    const float         clamped_depth = std::clamp(depth, 0.f, max_depth);
+    const std::uint64_t depth_steps   = static_cast<std::uint64_t>(clamped_depth / max_depth * static_cast<float>((1 << depth_bits) - 1));
+
+    std::uint64_t key = field(static_cast<std::uint64_t>(pass), pass_bits);
+    key               = key << program_bits | field(program, program_bits);
+    key               = key << mesh_bits | field(mesh, mesh_bits);
+    key               = key << texture_bits | field(texture, texture_bits);
+    key               = key << depth_bits | field(depth_steps, depth_bits);
+    return key;
+}
+
+void RenderQueue::submit(std::uint64_t key, const DrawItem& item)
+{
+    m_entries.push_back({key, static_cast<std::uint32_t>(m_items.size())});
+    m_items.push_back(item);
+}
+
+void RenderQueue::clear()
+{
+    m_items.clear();
+    m_entries.clear();
+}
+
+void RenderQueue::sort()
+{
+    PROFILE_ZONE("Render queue sort");
+    if (m_entries.empty())
+        return;
+
+    // Least significant digit radix sort, one byte per pass, all the histograms built in a single read of the keys
+    constexpr unsigned                                      digit_count = sizeof(std::uint64_t);
+    std::array<std::array<std::uint32_t, 256>, digit_count> histograms{};
+    for (const SortEntry& entry : m_entries)
+    {
+        for (unsigned digit = 0; digit < digit_count; digit++)
+        {
+            histograms[digit][(entry.key >> (8 * digit)) & 0xFF]++;
+        }
+    }
+
+    m_scratch.resize(m_entries.size());
+    for (unsigned digit = 0; digit < digit_count; digit++)
+    {
+        std::array<std::uint32_t, 256>& histogram = histograms[digit];
+        // Digits shared by every key, such as the pass and program bits of a small scene, need no pass
+        if (histogram[(m_entries.front().key >> (8 * digit)) & 0xFF] == m_entries.size())
+            continue;
+
+        std::uint32_t offset = 0;
+        for (std::uint32_t& count : histogram)
+        {
+            const std::uint32_t bucket_size = count;
+            count                           = offset;
+            offset += bucket_size;
+        }
+        for (const SortEntry& entry : m_entries)
+        {
+            m_scratch[histogram[(entry.key >> (8 * digit)) & 0xFF]++] = entry;
+        }
+        m_entries.swap(m_scratch);
+    }
+}
+
+void RenderQueue::draw(const glm::mat4& view_matrix, const glm::mat4& proj_matrix)
+{
+    sort();
+
+    PROFILE_ZONE("Render queue draw");
+    constexpr std::uint64_t state_mask = ~field(~std::uint64_t{0}, depth_bits);
+    m_last_item_count                  = m_entries.size();
+    m_last_run_count                   = 0;
+    GLState::enable_cull_face(true);
+    for (std::size_t i = 0; i < m_entries.size(); i++)
+    {
+        const SortEntry& entry = m_entries[i];
+        if (i == 0 || (entry.key & state_mask) != (m_entries[i - 1].key & state_mask))
+            m_last_run_count++;
+
+        const DrawItem& item = m_items[entry.item];
+        const auto      pass = static_cast<RenderPass>(entry.key >> (64 - pass_bits));
+        GLState::cull_face(pass == RenderPass::BackFaces ? GL_FRONT : GL_BACK);
+        switch (item.kind)
+        {
+        case DrawKind::Object:
+            item.object->render_game_object(*item.program, view_matrix, proj_matrix, item.outline_scale);
+            break;
+        case DrawKind::Instances:
+            item.object->render_instances(*item.program, view_matrix, proj_matrix, *item.instances, item.first, item.count, item.outline_scale);
+            break;
+        }
+    }
+    GLState::enable_cull_face(false);
+    clear();
+}
+
+void RenderQueue::draw_Gui() const
+{
+    ImGui::Text("Render queue: %zu draws in %zu runs of shared state", m_last_item_count, m_last_run_count);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+#include "p6/p6.h"
+
+class GameObject;
+class InstanceBuffer;
+class Program;
+
+// Passes are drawn in this order, each with its own face culling
+enum class RenderPass : std::uint8_t {
+    BackFaces,  // Front faces culled: the inside of the sky
+    FrontFaces, // Back faces culled: everything else
+};
+
+enum class DrawKind : std::uint8_t {
+    Object,
+    Instances,
+};
+
+struct DrawItem {
+    GameObject*           object;
+    Program*              program;
+    DrawKind              kind;
+    float                 outline_scale = 0.f; // Outline drawn in the same call, see GameObject::render_game_object
+    const InstanceBuffer* instances     = nullptr;
+    std::size_t           first         = 0;
+    std::size_t           count         = 0;
+};
+
+// Draws submitted by the game objects during the frame, sorted before drawing so that the draws sharing a program,
+// a mesh and a texture follow each other whatever the order of submission. The state changes between them are then
+// skipped by GLState. Inside a pass, items are ordered by program, then mesh, then texture, then front to back.
+class RenderQueue {
+public:
+    static constexpr float max_depth = 100.f; // Far plane of the camera, farther items share the last depth
+
+    // Packs the order of an item into 64 bits: pass (2), program (10), mesh (16), texture (12), depth (24).
+    // Names wider than their field are truncated, which can only interleave draws that would not share state.
+    static std::uint64_t make_key(RenderPass pass, GLuint program, GLuint mesh, GLuint texture, float depth);
+
+    void submit(std::uint64_t key, const DrawItem& item);
+    void clear();
+
+    // Sorts the items, draws them, then empties the queue
+    void draw(const glm::mat4& view_matrix, const glm::mat4& proj_matrix);
+
+    // Sorts the items by key, submission order breaking ties, as draw() does first.
+    // Then the i-th item to draw is the get_sorted_item(i)-th submitted.
+    void          sort();
+    std::uint32_t get_sorted_item(std::size_t i) const { return m_entries[i].item; }
+
+    // Of the last draw(), items and runs of items sharing program, mesh and texture
+    std::size_t get_item_count() const { return m_last_item_count; }
+    std::size_t get_state_run_count() const { return m_last_run_count; }
+
+    void draw_Gui() const;
+
+private:
+    struct SortEntry {
+        std::uint64_t key;
+        std::uint32_t item;
+    };
+
+    std::vector<DrawItem>  m_items;
+    std::vector<SortEntry> m_entries;
+    std::vector<SortEntry> m_scratch;
+
+    std::size_t m_last_item_count = 0;
+    std::size_t m_last_run_count  = 0;
+};
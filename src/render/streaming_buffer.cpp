@@ -0,0 +1,142 @@
+#include "streaming_buffer.hpp"
+#include <bit>
+#include <iostream>
+#include "profiling/profiler.hpp"
+
+// The loader only declares the flags of the versions and extensions it was generated for
+static bool has_buffer_storage()
+{
+#ifdef GL_VERSION_4_4
+    if (GLAD_GL_VERSION_4_4)
+        return true;
+#endif
+#ifdef GL_ARB_buffer_storage
+    if (GLAD_GL_ARB_buffer_storage)
+        return true;
+#endif
+    return false;
+}
+
+StreamingBuffer::StreamingBuffer()
+    : m_persistent(has_buffer_storage())
+{
+}
+
+StreamingBuffer::~StreamingBuffer()
+{
+    for (GLsync& fence : m_fences)
+    {
+        if (fence != nullptr)
+            glDeleteSync(fence);
+    }
+    if (m_mapped != nullptr)
+    {
+        m_vbo.bind();
+        m_vbo.unmap();
+        m_vbo.unbind();
+    }
+}
+
+std::size_t StreamingBuffer::region_size_for(std::size_t size)
+{
+    return std::bit_ceil((size + region_alignment - 1) / region_alignment * region_alignment);
+}
+
+void StreamingBuffer::allocate(std::size_t region_size)
+{
+    // The storage cannot grow: a new buffer replaces it, the GL keeps the old one alive for the frames still reading it
+    for (GLsync& fence : m_fences)
+    {
+        if (fence != nullptr)
+            glDeleteSync(fence);
+        fence = nullptr;
+    }
+    m_vbo.bind();
+    if (m_mapped != nullptr)
+        m_vbo.unmap();
+    m_vbo.reset();
+    m_vbo.bind();
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    m_region_size          = region_size;
+    m_vbo.allocate_storage(static_cast<GLsizeiptr>(region_count * m_region_size), flags);
+    m_mapped = static_cast<std::byte*>(m_vbo.map_range(0, static_cast<GLsizeiptr>(region_count * m_region_size), flags));
+    m_vbo.unbind();
+    if (m_mapped == nullptr)
+    {
+        std::cerr << "Error: could not map a streaming buffer of " << region_count * m_region_size << " bytes persistently, orphaning it every frame instead" << std::endl;
+        m_region_size = 0;
+        m_persistent  = false;
+        m_vbo.reset(); // Immutable storage cannot be orphaned
+    }
+}
+
+void StreamingBuffer::wait_for(GLsync& fence)
+{
+    if (fence == nullptr)
+        return;
+
+    // Usually signaled long ago, the GPU is only region_count - 1 frames behind when it is the bottleneck
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED)
+    {
+        PROFILE_ZONE("Streaming buffer stall");
+        m_stall_count++;
+        do
+        {
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000);
+        } while (status == GL_TIMEOUT_EXPIRED);
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+std::span<std::byte> StreamingBuffer::begin_writing(std::size_t size)
+{
+    if (size == 0)
+        return {};
+
+    if (!m_persistent)
+    {
+        // Orphans the storage of the previous frame, then maps the new one without waiting for the GPU
+        m_vbo.bind();
+        m_vbo.fill(nullptr, static_cast<GLsizei>(size), GL_STREAM_DRAW);
+        void* memory = m_vbo.map_range(0, static_cast<GLsizeiptr>(size), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        m_vbo.unbind();
+        m_offset = 0;
+        if (memory == nullptr)
+            return {};
+        return {static_cast<std::byte*>(memory), size};
+    }
+
+    if (size > m_region_size)
+    {
+        allocate(region_size_for(size));
+        if (!m_persistent)
+            return begin_writing(size);
+    }
+
+    m_region = next_region(m_region);
+    wait_for(m_fences[m_region]);
+    m_offset = static_cast<GLintptr>(m_region * m_region_size);
+    return {m_mapped + m_offset, size};
+}
+
+void StreamingBuffer::end_writing()
+{
+    // The persistent mapping is coherent, writes are visible to the draws issued after this
+    if (m_persistent)
+        return;
+    m_vbo.bind();
+    m_vbo.unmap();
+    m_vbo.unbind();
+}
+
+void StreamingBuffer::end_frame()
+{
+    if (!m_persistent || m_mapped == nullptr)
+        return;
+    if (m_fences[m_region] != nullptr)
+        glDeleteSync(m_fences[m_region]);
+    m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include "p6/p6.h"
+#include "vbo.hpp"
+
+// Vertex data rewritten every frame, handed to the GPU without stalling the driver.
+// With GL 4.4 or ARB_buffer_storage, the storage is split in region_count regions and mapped once, persistently and
+// coherently: each frame writes the next region in place while the GPU may still read the previous ones, and a fence
+// per region tells when it is free again. Older GLs orphan the buffer every frame instead: glBufferData without data
+// lets the driver hand out fresh storage while the GPU keeps the old one, and the new storage is mapped for writing.
+class StreamingBuffer {
+public:
+    static constexpr std::size_t region_count = 3;
+
+    StreamingBuffer();
+    ~StreamingBuffer();
+    StreamingBuffer(const StreamingBuffer&)            = delete;
+    StreamingBuffer& operator=(const StreamingBuffer&) = delete;
+
+    // Mapped memory for size bytes of this frame, write-only and valid until end_writing().
+    // Waits when the GPU is still reading the region from region_count frames ago. Empty when the GL cannot map.
+    std::span<std::byte> begin_writing(std::size_t size);
+    void                 end_writing();
+
+    // Called once the draws reading the data of this frame are issued
+    void end_frame();
+
+    void bind() const { m_vbo.bind(); }
+    void unbind() const { m_vbo.unbind(); }
+
+    // Where the data of this frame starts in the buffer, for the attribute pointers
+    GLintptr get_offset() const { return m_offset; }
+
+    bool          is_persistent() const { return m_persistent; }
+    std::uint64_t get_stall_count() const { return m_stall_count; }
+
+    static constexpr std::size_t region_alignment = 256;
+
+    // Size of the regions allocated for size bytes: aligned, and rounded up to a power of two so that it rarely grows
+    static std::size_t region_size_for(std::size_t size);
+    // Region written by the frame after the one that wrote region, its fence is waited for first
+    static std::size_t next_region(std::size_t region) { return (region + 1) % region_count; }
+
+private:
+
+    VBO         m_vbo;
+    bool        m_persistent;
+    std::byte*  m_mapped      = nullptr; // Start of the persistent mapping
+    std::size_t m_region_size = 0;
+    std::size_t m_region      = 0;
+    GLintptr    m_offset      = 0;
+
+    std::array<GLsync, region_count> m_fences{};
+    std::uint64_t                    m_stall_count = 0; // Frames that had to wait for the GPU
+
+    void allocate(std::size_t region_size);
+    void wait_for(GLsync& fence);
+};
@@ -1,14 +1,18 @@
 #include "texture_manager.hpp"
+#include "gl_state.hpp"
+#include "profiling/profiler.hpp"
 
 GLuint TextureManager::load_texture(const std::string& file_path)
 {
+    PROFILE_ZONE("Load texture");
+
     // Load image from file
     img::Image texture_image = p6::load_image_buffer(file_path);
 
     // Generate the OpenGL texture object
     GLuint texture_object = 0;
     glGenTextures(1, &texture_object);
-    glBindTexture(GL_TEXTURE_2D, texture_object);
+    bind_texture(texture_object, 0);
 
     // Configure texture settings
     GLsizei width  = static_cast<GLsizei>(texture_image.width());
@@ -29,11 +33,10 @@ GLuint TextureManager::load_texture(const std::string& file_path)
 
 void TextureManager::bind_texture(GLuint texture_id, GLuint texture_unit)
 {
-    glActiveTexture(GL_TEXTURE0 + texture_unit);
-    glBindTexture(GL_TEXTURE_2D, texture_id);
+    GLState::bind_texture(texture_unit, texture_id);
 }
 
 void TextureManager::unbind_texture()
 {
-    glBindTexture(GL_TEXTURE_2D, 0);
+    GLState::bind_texture(0, 0);
 }
@@ -1,4 +1,5 @@
 #include "vao.hpp"
+#include "gl_state.hpp"
 
 VAO::VAO()
 {
@@ -7,21 +8,33 @@ VAO::VAO()
 
 VAO::~VAO()
 {
+    GLState::forget_vertex_array(id);
     glDeleteVertexArrays(1, &id);
 }
 
 void VAO::bind() const
 {
-    glBindVertexArray(id);
+    GLState::bind_vertex_array(id);
 }
 
 void VAO::unbind() const
 {
-    glBindVertexArray(0);
+    GLState::bind_vertex_array(0);
 }
 
 void VAO::specify_attribute(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid* pointer)
 {
     glEnableVertexAttribArray(index);
     glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+}
+
+void VAO::specify_instance_attribute(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid* pointer, GLuint divisor)
+{
+    specify_attribute(index, size, type, normalized, stride, pointer);
+    glVertexAttribDivisor(index, divisor);
+}
+
+void VAO::disable_attribute(GLuint index)
+{
+    glDisableVertexAttribArray(index);
 }
\ No newline at end of file
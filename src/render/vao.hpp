@@ -11,6 +11,11 @@ public:
     void bind() const;
     void unbind() const;
     void specify_attribute(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid* pointer);
+    // Attribute read once per divisor instances rather than once per vertex
+    void specify_instance_attribute(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid* pointer, GLuint divisor = 1);
+    void disable_attribute(GLuint index);
+
+    GLuint get_id() const { return id; }
 
 private:
     GLuint id;
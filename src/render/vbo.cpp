@@ -23,4 +23,25 @@ void VBO::unbind() const
 void VBO::fill(const void* data, GLsizei size, GLenum usage)
 {
     glBufferData(GL_ARRAY_BUFFER, size, data, usage);
+}
+
+void VBO::allocate_storage(GLsizeiptr size, GLbitfield flags)
+{
+    glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+}
+
+void* VBO::map_range(GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+    return glMapBufferRange(GL_ARRAY_BUFFER, offset, length, access);
+}
+
+void VBO::unmap()
+{
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+}
+
+void VBO::reset()
+{
+    glDeleteBuffers(1, &id);
+    glGenBuffers(1, &id);
 }
\ No newline at end of file
@@ -11,6 +11,14 @@ public:
     void unbind() const;
     void fill(const void* data, GLsizei size, GLenum usage);
 
+    // Immutable storage of glBufferStorage, it can only change size with reset()
+    void  allocate_storage(GLsizeiptr size, GLbitfield flags);
+    void* map_range(GLintptr offset, GLsizeiptr length, GLbitfield access);
+    void  unmap();
+
+    // Replaces the buffer by a new one without storage, the GL frees the old one once the GPU is done with it
+    void reset();
+
 private:
     GLuint id;
 };
\ No newline at end of file
@@ -0,0 +1,34 @@
+#include "view_distances.hpp"
+#include "maths/cpu_dispatch.hpp"
+#include "profiling/profiler.hpp"
+
+using DistanceKernel = void (*)(std::span<const glm::vec3> positions, const glm::mat4& view_matrix, float* squared_distances);
+
+// Length of the position in view space, which is relative to the camera
+static void distances_portable(std::span<const glm::vec3> positions, const glm::mat4& view_matrix, float* squared_distances)
+{
+    for (std::size_t i = 0; i < positions.size(); i++)
+    {
+        const glm::vec3 position(view_matrix * glm::vec4(positions[i], 1.f));
+        squared_distances[i] = glm::dot(position, position);
+    }
+}
+
+BOIDS_TARGET_AVX2 static void distances_avx2(std::span<const glm::vec3> positions, const glm::mat4& view_matrix, float* squared_distances)
+{
+    distances_portable(positions, view_matrix, squared_distances);
+}
+
+BOIDS_TARGET_AVX512 static void distances_avx512(std::span<const glm::vec3> positions, const glm::mat4& view_matrix, float* squared_distances)
+{
+    distances_portable(positions, view_matrix, squared_distances);
+}
+
+void compute_view_distances(std::span<const glm::vec3> positions, const glm::mat4& view_matrix, std::vector<float>& squared_distances)
+{
+    PROFILE_ZONE("View distances");
+    static const DistanceKernel kernel = select_kernel<DistanceKernel>(active_isa(), &distances_portable, &distances_avx2, &distances_avx512);
+
+    squared_distances.resize(positions.size());
+    kernel(positions, view_matrix, squared_distances.data());
+}
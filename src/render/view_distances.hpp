@@ -0,0 +1,9 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include "glm/glm.hpp"
+
+// Squared distances from the camera to many positions, such as the boids, to pick the drawn ones and their mesh.
+// Runs the copy of the kernel matching the CPU, see cpu_dispatch.hpp.
+void compute_view_distances(std::span<const glm::vec3> positions, const glm::mat4& view_matrix, std::vector<float>& squared_distances);
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include "glimac/trackball_camera.hpp"
+#include "p6/p6.h"
+#include "scene_objects/boid.hpp"
+
+enum SurveyorKey : unsigned {
+    KEY_FORWARD  = 1u << 0,
+    KEY_BACKWARD = 1u << 1,
+    KEY_LEFT     = 1u << 2,
+    KEY_RIGHT    = 1u << 3,
+    KEY_UP       = 1u << 4,
+    KEY_DOWN     = 1u << 5,
+};
+
+// Everything the user did during one frame, so that a session can be recorded and replayed identically
+struct FrameInput {
+    unsigned surveyor_keys      = 0; // SurveyorKey bits held down
+    float    camera_rotate_left = 0.f;
+    float    camera_rotate_up   = 0.f;
+    float    camera_move_front  = 0.f;
+    bool     camera_reset       = false;
+
+    // Edits of the frame, applied after the GUI, when they happened
+    std::optional<BoidVariables> variables; // Every GUI variable, before the quality tier
+    std::optional<std::size_t>   boid_count;
+    bool                         picked = false; // A click picked picked_boid, or nothing
+    std::optional<std::uint32_t> picked_boid;
+    std::optional<std::size_t>   quality_level; // Of the QualityController, replays freeze it there
+
+    static unsigned read_surveyor_keys(const p6::Context& ctx)
+    {
+        unsigned keys = 0;
+        if (ctx.key_is_pressed(GLFW_KEY_W))
+            keys |= KEY_FORWARD;
+        if (ctx.key_is_pressed(GLFW_KEY_S))
+            keys |= KEY_BACKWARD;
+        if (ctx.key_is_pressed(GLFW_KEY_A))
+            keys |= KEY_LEFT;
+        if (ctx.key_is_pressed(GLFW_KEY_D))
+            keys |= KEY_RIGHT;
+        if (ctx.key_is_pressed(GLFW_KEY_UP))
+            keys |= KEY_UP;
+        if (ctx.key_is_pressed(GLFW_KEY_DOWN))
+            keys |= KEY_DOWN;
+        return keys;
+    }
+
+    void apply_to_camera(TrackballCamera& camera) const
+    {
+        camera.rotate_left(camera_rotate_left);
+        camera.rotate_up(camera_rotate_up);
+        camera.move_front(camera_move_front);
+        if (camera_reset)
+        {
+            camera.reset_camera();
+        }
+    }
+};
@@ -0,0 +1,195 @@
+#include "scenario.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include "maths/percentile.hpp"
+#include "profiling/profiler.hpp"
+
+// Every field of BoidVariables, in the order of the struct
+static std::ostream& write_variables(std::ostream& out, const BoidVariables& v)
+{
+    return out << v.cube_length << ' ' << v.radius_awareness << ' ' << v.separate << ' ' << v.align << ' ' << v.cohesion << ' ' << v.flow << ' '
+               << v.max_neighbors << ' ' << v.time_sliced << ' ' << v.step_budget_us << ' ' << v.steps_per_second << ' ' << v.verlet_lists << ' '
+               << v.verlet_skin << ' ' << v.unbounded_world << ' ' << v.huge_pages << ' ' << v.sample_neighbors << ' ' << v.sample_size << ' ' << v.isLowPoly;
+}
+
+static std::istream& read_variables(std::istream& in, BoidVariables& v)
+{
+    return in >> v.cube_length >> v.radius_awareness >> v.separate >> v.align >> v.cohesion >> v.flow >> v.max_neighbors >> v.time_sliced
+           >> v.step_budget_us >> v.steps_per_second >> v.verlet_lists >> v.verlet_skin >> v.unbounded_world >> v.huge_pages
+           >> v.sample_neighbors >> v.sample_size >> v.isLowPoly;
+}
+
+// Tagged edits after the input of a frame, see FrameInput
+static bool read_edits(std::istream& in, FrameInput& frame)
+{
+    std::string tag;
+    while (in >> tag)
+    {
+        if (tag == "variables")
+        {
+            frame.variables.emplace();
+            if (!read_variables(in, *frame.variables))
+                return false;
+        }
+        else if (tag == "boids")
+        {
+            frame.boid_count.emplace();
+            if (!(in >> *frame.boid_count))
+                return false;
+        }
+        else if (tag == "pick")
+        {
+            long long index = 0;
+            if (!(in >> index))
+                return false;
+            frame.picked = true;
+            if (index >= 0)
+                frame.picked_boid = static_cast<std::uint32_t>(index);
+        }
+        else if (tag == "quality")
+        {
+            frame.quality_level.emplace();
+            if (!(in >> *frame.quality_level))
+                return false;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// File layout: a "scenario <seed> <boid count> <frame count>" header, then one line per frame:
+// <surveyor keys> <camera rotate left> <camera rotate up> <camera move front> <camera reset>
+// followed by the edits of the frame, if any: "variables <every BoidVariables field>", "boids <count>" and
+// "pick <boid index, or -1 for none>" and "quality <level>"
+std::optional<Scenario> Scenario::load(const std::string& file_path)
+{
+    std::ifstream in(file_path);
+    if (!in)
+    {
+        std::cerr << "Error: cannot open scenario " << file_path << '\n';
+        return std::nullopt;
+    }
+
+    Scenario    scenario;
+    std::string tag;
+    std::size_t frame_count = 0;
+    if (!(in >> tag >> scenario.seed >> scenario.boid_count >> frame_count) || tag != "scenario")
+    {
+        std::cerr << "Error: " << file_path << " is not a scenario file." << '\n';
+        return std::nullopt;
+    }
+    std::string line;
+    std::getline(in, line); // End of the header
+
+    scenario.frames.resize(frame_count);
+    for (FrameInput& frame : scenario.frames)
+    {
+        if (!std::getline(in, line))
+        {
+            std::cerr << "Error: scenario " << file_path << " is truncated." << '\n';
+            return std::nullopt;
+        }
+        std::istringstream fields(line);
+        if (!(fields >> frame.surveyor_keys >> frame.camera_rotate_left >> frame.camera_rotate_up >> frame.camera_move_front >> frame.camera_reset) || !read_edits(fields, frame))
+        {
+            std::cerr << "Error: scenario " << file_path << " has an invalid frame: " << line << '\n';
+            return std::nullopt;
+        }
+    }
+    return scenario;
+}
+
+bool Scenario::save(const std::string& file_path) const
+{
+    std::ofstream out(file_path);
+    if (!out)
+    {
+        std::cerr << "Error: cannot write scenario " << file_path << '\n';
+        return false;
+    }
+
+    out << "scenario " << seed << ' ' << boid_count << ' ' << frames.size() << '\n';
+    out << std::setprecision(9);
+    for (const FrameInput& frame : frames)
+    {
+        out << frame.surveyor_keys << ' ' << frame.camera_rotate_left << ' ' << frame.camera_rotate_up << ' ' << frame.camera_move_front << ' ' << frame.camera_reset;
+        if (frame.variables)
+            write_variables(out << " variables ", *frame.variables);
+        if (frame.boid_count)
+            out << " boids " << *frame.boid_count;
+        if (frame.picked)
+            out << " pick " << (frame.picked_boid ? static_cast<long long>(*frame.picked_boid) : -1);
+        if (frame.quality_level)
+            out << " quality " << *frame.quality_level;
+        out << '\n';
+    }
+    return true;
+}
+
+void ScenarioReport::add_frame(double frame_ms, const std::vector<std::pair<std::string, double>>& zones_ms)
+{
+    m_frame_ms.push_back(frame_ms);
+    for (const auto& [name, duration_ms] : zones_ms)
+    {
+        m_zones_ms[name].push_back(duration_ms);
+    }
+}
+
+static double percentile(std::vector<double> samples, double p)
+{
+    if (samples.empty())
+        return 0.;
+
+    const std::size_t rank = percentile_index(samples.size(), p);
+    std::nth_element(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(rank), samples.end());
+    return samples[rank];
+}
+
+static void print_row(std::ostream& out, const std::string& name, const std::vector<double>& samples)
+{
+    out << std::left << std::setw(20) << name << std::right << std::fixed << std::setprecision(3)
+        << std::setw(10) << percentile(samples, 50.) << std::setw(10) << percentile(samples, 95.) << std::setw(10) << percentile(samples, 99.)
+        << std::setw(10) << samples.size() << '\n';
+}
+
+void ScenarioReport::print(std::ostream& out) const
+{
+    out << std::left << std::setw(20) << "phase (ms)" << std::right << std::setw(10) << "p50" << std::setw(10) << "p95" << std::setw(10) << "p99" << std::setw(10) << "frames" << '\n';
+    print_row(out, "Frame", m_frame_ms);
+    for (const auto& [name, samples] : m_zones_ms)
+    {
+        print_row(out, name, samples);
+    }
+}
+
+ScenarioPlayer::ScenarioPlayer(Scenario scenario)
+    : m_scenario(std::move(scenario))
+{
+}
+
+bool ScenarioPlayer::begin_frame()
+{
+    // The zones of a frame are only collected at the start of the next one
+    if (m_frame > 0)
+    {
+        m_report.add_frame(m_frame_ms, Profiler::last_frame_zones());
+    }
+
+    if (m_frame == m_scenario.frames.size())
+        return false;
+
+    m_frame++;
+    m_frame_start = std::chrono::steady_clock::now();
+    return true;
+}
+
+void ScenarioPlayer::end_frame()
+{
+    m_frame_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_frame_start).count();
+}
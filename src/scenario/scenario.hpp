@@ -0,0 +1,54 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+#include "frame_input.hpp"
+
+// Recorded session: the seed and flock size it started with, and the input and GUI edits of every frame.
+// Replaying it with a fixed time step reproduces the same frames on any build.
+struct Scenario {
+    unsigned                seed       = 0;
+    std::size_t             boid_count = 80;
+    std::vector<FrameInput> frames;
+
+    static std::optional<Scenario> load(const std::string& file_path);
+    bool                           save(const std::string& file_path) const;
+};
+
+// Frame time percentiles of a replayed scenario, overall and per profiler zone
+class ScenarioReport {
+public:
+    void add_frame(double frame_ms, const std::vector<std::pair<std::string, double>>& zones_ms);
+    void print(std::ostream& out) const;
+
+private:
+    std::vector<double>                        m_frame_ms;
+    std::map<std::string, std::vector<double>> m_zones_ms;
+};
+
+// Feeds the frames of a scenario one by one and measures each of them
+class ScenarioPlayer {
+public:
+    explicit ScenarioPlayer(Scenario scenario);
+
+    // To call at the start of every frame, after Profiler::collect(). Returns false once every frame was played.
+    bool begin_frame();
+    // To call once the draws of the frame are submitted: the buffer swap and the wait for vsync are not measured
+    void end_frame();
+
+    const Scenario&       get_scenario() const { return m_scenario; }
+    const FrameInput&     get_input() const { return m_scenario.frames[m_frame - 1]; }
+    const ScenarioReport& get_report() const { return m_report; }
+
+private:
+    Scenario                              m_scenario;
+    ScenarioReport                        m_report;
+    std::size_t                           m_frame    = 0;
+    double                                m_frame_ms = 0.;
+    std::chrono::steady_clock::time_point m_frame_start;
+};
@@ -1,6 +1,11 @@
 #include "boid.hpp"
+#include <algorithm>
+#include <array>
+#include <utility>
 #include "cmath"
 #include "glm/gtx/norm.hpp"
+#include "maths/counter_rng.hpp"
+#include "simulation/boid_pool.hpp"
 
 static glm::vec3 limit(glm::vec3 force)
 {
@@ -37,17 +42,16 @@ Boid::Boid()
     m_color    = generate_vivid_color();
 }
 
-void Boid::update(p6::Context* ctx, const std::vector<Boid>& boids, BoidVariables variables)
+Boid::Boid(const glm::vec3& position, const glm::vec3& velocity, const Color& color)
+    : m_position(position), m_velocity(velocity), m_color(color)
 {
-    glm::vec3 acceleration{0.f};
-
-    acceleration += cohesion(boids, variables.radius_awareness) * variables.cohesion;
-    acceleration += align(boids, variables.radius_awareness) * variables.align;
-    acceleration += separate(boids, variables.radius_awareness) * variables.separate;
+}
 
-    m_velocity += acceleration;
-    m_velocity = limit(m_velocity);
+void Boid::integrate(const BoidVariables& variables)
+{
     m_position += m_velocity;
+    if (variables.unbounded_world)
+        return;
 
     // to keep the boids inside the cube
     float edge_offset = 4.;
@@ -56,66 +60,158 @@ void Boid::update(p6::Context* ctx, const std::vector<Boid>& boids, BoidVariable
     m_position.z      = manage_edge_collision(m_position.z, variables.cube_length, edge_offset);
 }
 
-glm::vec3 Boid::align(const std::vector<Boid>& boids, float radius_awareness)
+// Steering from the neighbors within radius_awareness, the boid itself included in the means: cohesion adds their mean
+// position, alignment their mean velocity, and separation the mean of the offsets away from the others, each divided by
+// the squared distance, minus the velocity. Every force is clamped then weighted by its variable, the new velocity is
+// clamped too.
+// A single pass over the neighbor candidates gathers only what the enabled rules need.
+// Candidates come nearest cells first, so stopping at max_neighbors keeps the closest ones.
+// The statistics of the flock are accumulated on the way.
+// When Sampled, other boids are kept with a probability that leaves about search.sample_size of the candidates, and
+// kept ones weigh 1 / probability: every sum, and the neighbor count, stays an unbiased estimate of the exact one.
+template<unsigned Rules, bool Sampled>
+glm::vec3 Boid::steer_with_rules(std::size_t index, const BoidPool& boids, const NeighborSearch& search, const FlowField& flow, const BoidVariables& variables, FlockStatistics& statistics) const
 {
-    glm::vec3 target(0.f);
-    int       count = 0;
+    glm::vec3 acceleration{0.f};
+    bool      capped         = false;
+    float     neighbor_count = 0.f;
 
-    for (const auto& b : boids)
+    if constexpr ((Rules & NEIGHBOR_RULES) != 0)
     {
-        if (sqrt(glm::distance2(b.m_position, this->m_position)) < radius_awareness)
+        glm::vec3 velocity_sum(0.f);
+        glm::vec3 position_sum(0.f);
+        glm::vec3 repulsion_sum(0.f);
+        float     count   = 0.f; // Includes the boid itself in the means
+        int       visited = 0;
+
+        // Gaps between kept candidates follow a geometric law, so skipped ones cost neither a draw nor a memory access
+        float      keep_probability = 1.f;
+        CounterRng rng(search.sampling_seed, index);
+        auto       draw_skip = [&]() -> std::size_t {
+            if (keep_probability >= 1.f)
+                return 0;
+            return static_cast<std::size_t>(std::log(1.f - rng.next_float()) / std::log1p(-keep_probability));
+        };
+        std::size_t skip = 0;
+        if constexpr (Sampled)
         {
-            target += b.m_velocity;
-            count++;
+            const std::size_t candidates = search.count_candidates(index, m_position);
+            if (candidates > 0)
+                keep_probability = std::min(1.f, search.sample_size / static_cast<float>(candidates));
+            skip = draw_skip();
+        }
+        const float sample_weight = 1.f / keep_probability;
+
+        search.visit(index, m_position, [&](std::uint32_t candidate) {
+            float weight = 1.f;
+            if constexpr (Sampled)
+            {
+                // The boid itself is always kept, its weight is known
+                if (candidate != index)
+                {
+                    if (skip > 0)
+                    {
+                        skip--;
+                        return true;
+                    }
+                    skip   = draw_skip();
+                    weight = sample_weight;
+                }
+            }
+
+            const Boid& other    = boids[candidate];
+            float       distance = sqrt(glm::distance2(m_position, other.m_position));
+            if (distance < variables.radius_awareness)
+            {
+                count += weight;
+                visited++;
+                if constexpr ((Rules & RULE_ALIGN) != 0)
+                    velocity_sum += weight * other.m_velocity;
+                if constexpr ((Rules & RULE_COHESION) != 0)
+                    position_sum += weight * other.m_position;
+                if (&other != this)
+                {
+                    neighbor_count += weight;
+                    if constexpr ((Rules & RULE_SEPARATE) != 0)
+                    {
+                        glm::vec3 diff = m_position - other.m_position;
+                        diff /= distance * distance;
+                        repulsion_sum += weight * diff;
+                    }
+                }
+                if (visited >= variables.max_neighbors)
+                {
+                    capped = true;
+                    return false;
+                }
+            }
+            return true;
+        });
+
+        if constexpr ((Rules & RULE_COHESION) != 0)
+        {
+            glm::vec3 target = (count > 0.f) ? (position_sum / count) : position_sum;
+            acceleration += limit(target) * variables.cohesion;
+        }
+        if constexpr ((Rules & RULE_ALIGN) != 0)
+        {
+            if (count > 0.f)
+                acceleration += limit(velocity_sum / count) * variables.align;
+        }
+        if constexpr ((Rules & RULE_SEPARATE) != 0)
+        {
+            if (neighbor_count > 0.f)
+                acceleration += limit(repulsion_sum / neighbor_count - m_velocity) * variables.separate;
         }
     }
-    if (count > 0)
+
+    if constexpr ((Rules & RULE_FLOW) != 0)
     {
-        target /= count;
-        target = limit(target);
+        acceleration += limit(flow.sample(m_position)) * variables.flow;
     }
-    return target;
+
+    const glm::vec3 velocity = limit(m_velocity + acceleration);
+    statistics.add_boid(static_cast<int>(std::lround(neighbor_count)), capped, velocity);
+    return velocity;
 }
 
-glm::vec3 Boid::separate(const std::vector<Boid>& boids, float radius_awareness)
+template<unsigned Rules, bool Sampled>
+BOIDS_TARGET_AVX2 glm::vec3 Boid::steer_with_rules_avx2(std::size_t index, const BoidPool& boids, const NeighborSearch& search, const FlowField& flow, const BoidVariables& variables, FlockStatistics& statistics) const
 {
-    glm::vec3 target(0.f);
+    return steer_with_rules<Rules, Sampled>(index, boids, search, flow, variables, statistics);
+}
 
-    int count = 0;
-    for (const Boid& other : boids)
-    {
-        float distance = sqrt(glm::distance2(m_position, other.m_position));
-        if (&other != this && distance < radius_awareness)
-        {
-            glm::vec3 diff = m_position - other.m_position;
-            diff /= distance * distance;
-            target += diff;
-            count++;
-        }
-    }
-    if (count == 0)
-        return target;
+template<unsigned Rules, bool Sampled>
+BOIDS_TARGET_AVX512 glm::vec3 Boid::steer_with_rules_avx512(std::size_t index, const BoidPool& boids, const NeighborSearch& search, const FlowField& flow, const BoidVariables& variables, FlockStatistics& statistics) const
+{
+    return steer_with_rules<Rules, Sampled>(index, boids, search, flow, variables, statistics);
+}
 
-    target /= count;
-    glm::vec3 force = target - m_velocity;
-    force           = limit(force);
-    return force;
+template<bool Sampled, Isa Target, std::size_t... Rules>
+static constexpr std::array<Boid::StepKernel, sizeof...(Rules)> make_kernel_table(std::index_sequence<Rules...> /*rules*/)
+{
+    if constexpr (Target == Isa::Avx512)
+        return {&Boid::steer_with_rules_avx512<Rules, Sampled>...};
+    else if constexpr (Target == Isa::Avx2)
+        return {&Boid::steer_with_rules_avx2<Rules, Sampled>...};
+    else
+        return {&Boid::steer_with_rules<Rules, Sampled>...};
 }
 
-glm::vec3 Boid::cohesion(const std::vector<Boid>& boids, float radius_awareness)
+template<Isa Target>
+static Boid::StepKernel kernel_for_target(unsigned rules, bool sampled)
 {
-    int count = 0;
+    static constexpr auto kernels         = make_kernel_table<false, Target>(std::make_index_sequence<RULE_COMBINATIONS>{});
+    static constexpr auto sampled_kernels = make_kernel_table<true, Target>(std::make_index_sequence<RULE_COMBINATIONS>{});
+    return sampled ? sampled_kernels[rules % RULE_COMBINATIONS] : kernels[rules % RULE_COMBINATIONS];
+}
 
-    glm::vec3 target(0.f);
-    for (const auto& b : boids)
-    {
-        if (sqrt(glm::distance2(m_position, b.m_position)) < radius_awareness)
-        {
-            target += b.m_position;
-            count++;
-        }
-    }
-    target = (count > 0) ? (target / static_cast<float>(count)) : target;
-    target = limit(target);
-    return target;
-}
\ No newline at end of file
+Boid::StepKernel Boid::kernel_for(unsigned rules, bool sampled, Isa isa)
+{
+#if BOIDS_MULTIVERSION
+    return select_kernel(isa, &kernel_for_target<Isa::Portable>, &kernel_for_target<Isa::Avx2>, &kernel_for_target<Isa::Avx512>)(rules, sampled);
+#else
+    (void)isa;
+    return kernel_for_target<Isa::Portable>(rules, sampled);
+#endif
+}
@@ -1,8 +1,14 @@
 #pragma once
 
+#include <vector>
 #include "maths/color.hpp"
+#include "maths/cpu_dispatch.hpp"
 #include "maths/random_generator.hpp"
 #include "p6/p6.h"
+#include "simulation/flock_rules.hpp"
+#include "simulation/flock_statistics.hpp"
+#include "simulation/flow_field.hpp"
+#include "simulation/neighbor_search.hpp"
 
 struct BoidVariables {
     float cube_length      = 10.4;
@@ -10,18 +16,54 @@ struct BoidVariables {
     float separate         = 0.5;
     float align            = 0.5;
     float cohesion         = 0.5;
+    float flow             = 0.;
+    int   max_neighbors    = 64;
+    bool  time_sliced      = false;
+    int   step_budget_us   = 2000;
+    int   steps_per_second = 60;
+    bool  verlet_lists     = true;
+    float verlet_skin      = 0.5;
+    bool  unbounded_world  = false;
+    bool  huge_pages       = false;
+    bool  sample_neighbors = false;
+    int   sample_size      = 16;
     bool  isLowPoly        = false;
 
-    void draw_Gui()
+    // Returns true when a parameter was modified this frame
+    bool draw_Gui()
     {
-        ImGui::SliderFloat("Align", &align, 0.0f, 1.f);
-        ImGui::SliderFloat("Cohesion", &cohesion, 0.0f, 1.f);
-        ImGui::SliderFloat("Separate", &separate, 0.0f, 1.f);
-        ImGui::SliderFloat("Radius of awareness", &radius_awareness, 0.0f, 10.f);
-        ImGui::Checkbox("Low Poly", &isLowPoly);
+        bool changed = false;
+        changed |= ImGui::SliderFloat("Align", &align, 0.0f, 1.f);
+        changed |= ImGui::SliderFloat("Cohesion", &cohesion, 0.0f, 1.f);
+        changed |= ImGui::SliderFloat("Separate", &separate, 0.0f, 1.f);
+        changed |= ImGui::SliderFloat("Follow the thwomp", &flow, 0.0f, 1.f);
+        changed |= ImGui::SliderFloat("Radius of awareness", &radius_awareness, 0.0f, 10.f);
+        changed |= ImGui::SliderInt("Max neighbors", &max_neighbors, 1, 256);
+        changed |= ImGui::Checkbox("Sample neighbors", &sample_neighbors);
+        if (sample_neighbors)
+        {
+            changed |= ImGui::SliderInt("Sample size", &sample_size, 1, 128);
+        }
+        changed |= ImGui::Checkbox("Verlet neighbor lists", &verlet_lists);
+        if (verlet_lists)
+        {
+            changed |= ImGui::SliderFloat("Skin", &verlet_skin, 0.05f, 2.f);
+        }
+        changed |= ImGui::Checkbox("Unbounded world", &unbounded_world);
+        changed |= ImGui::Checkbox("Huge pages", &huge_pages);
+        changed |= ImGui::SliderInt("Simulation rate (Hz)", &steps_per_second, 10, 240);
+        changed |= ImGui::Checkbox("Time-sliced update", &time_sliced);
+        if (time_sliced)
+        {
+            changed |= ImGui::SliderInt("Step budget (us)", &step_budget_us, 100, 16000);
+        }
+        changed |= ImGui::Checkbox("Low Poly", &isLowPoly);
+        return changed;
     }
 };
 
+class BoidPool;
+
 class Boid {
 private:
     glm::vec3 m_position;
@@ -29,13 +71,28 @@ private:
     Color     m_color;
 
 public:
+    // Steering specialized for one set of enabled rules, see FlockRule.
+    // Returns the new velocity without touching the boid, so the whole flock can be steered in parallel.
+    // index is the position of the boid in boids.
+    using StepKernel = glm::vec3 (Boid::*)(std::size_t index, const BoidPool& boids, const NeighborSearch& search, const FlowField& flow, const BoidVariables& variables, FlockStatistics& statistics) const;
+
     Boid();
+    Boid(const glm::vec3& position, const glm::vec3& velocity, const Color& color);
 
     glm::vec3 get_position() const { return m_position; };
+    glm::vec3 get_velocity() const { return m_velocity; }
+    void      set_velocity(const glm::vec3& velocity) { m_velocity = velocity; }
     Color     get_color() const { return m_color; }
 
-    void      update(p6::Context* ctx, const std::vector<Boid>& boids, BoidVariables variables);
-    glm::vec3 align(const std::vector<Boid>& boids, float radius_awareness);
-    glm::vec3 cohesion(const std::vector<Boid>& boids, float radius_awareness);
-    glm::vec3 separate(const std::vector<Boid>& boids, float radius_awareness);
+    void integrate(const BoidVariables& variables);
+
+    // Portable kernel, and the same code compiled for each instruction set of cpu_dispatch.hpp
+    template<unsigned Rules, bool Sampled>
+    glm::vec3 steer_with_rules(std::size_t index, const BoidPool& boids, const NeighborSearch& search, const FlowField& flow, const BoidVariables& variables, FlockStatistics& statistics) const;
+    template<unsigned Rules, bool Sampled>
+    glm::vec3 steer_with_rules_avx2(std::size_t index, const BoidPool& boids, const NeighborSearch& search, const FlowField& flow, const BoidVariables& variables, FlockStatistics& statistics) const;
+    template<unsigned Rules, bool Sampled>
+    glm::vec3 steer_with_rules_avx512(std::size_t index, const BoidPool& boids, const NeighborSearch& search, const FlowField& flow, const BoidVariables& variables, FlockStatistics& statistics) const;
+
+    static StepKernel kernel_for(unsigned rules, bool sampled, Isa isa = active_isa());
 };
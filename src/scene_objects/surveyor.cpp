@@ -1,4 +1,5 @@
 #include "surveyor.hpp"
+#include "scenario/frame_input.hpp"
 
 Surveyor::Surveyor(GameObject* linked_game_object, std::vector<std::vector<double>> transition_matrix, std::vector<double> initial_state)
     : m_surveyor_object(linked_game_object), m_feelings_chain(transition_matrix, initial_state)
@@ -6,18 +7,18 @@ Surveyor::Surveyor(GameObject* linked_game_object, std::vector<std::vector<doubl
     m_light_intensity = glm::vec3(.01f, .01f, .01f);
 }
 
-void Surveyor::move_surveyor(p6::Context& ctx)
+void Surveyor::move_surveyor(unsigned keys)
 {
     float     speed = 0.05f;
     glm::vec3 movement(0.0f);
     // std::cout << "yolo\n";
 
-    movement.z += ctx.key_is_pressed(GLFW_KEY_S) ? speed : 0;
-    movement.z -= ctx.key_is_pressed(GLFW_KEY_W) ? speed : 0;
-    movement.x += ctx.key_is_pressed(GLFW_KEY_D) ? speed : 0;
-    movement.x -= ctx.key_is_pressed(GLFW_KEY_A) ? speed : 0;
-    movement.y += ctx.key_is_pressed(GLFW_KEY_UP) ? speed : 0;
-    movement.y -= ctx.key_is_pressed(GLFW_KEY_DOWN) ? speed : 0;
+    movement.z += (keys & KEY_BACKWARD) ? speed : 0;
+    movement.z -= (keys & KEY_FORWARD) ? speed : 0;
+    movement.x += (keys & KEY_RIGHT) ? speed : 0;
+    movement.x -= (keys & KEY_LEFT) ? speed : 0;
+    movement.y += (keys & KEY_UP) ? speed : 0;
+    movement.y -= (keys & KEY_DOWN) ? speed : 0;
 
     m_surveyor_object->move(movement);
 }
@@ -39,9 +40,9 @@ std::pair<glm::vec3, glm::vec3> Surveyor::calculate_wiggle_offsets(p6::Context&
     return {pos_offset, rot_offset};
 }
 
-void Surveyor::move_surveyor_with_wiggle(p6::Context& ctx)
+void Surveyor::move_surveyor_with_wiggle(p6::Context& ctx, unsigned keys)
 {
-    move_surveyor(ctx);
+    move_surveyor(keys);
     auto [pos_offset, rot_offset] = calculate_wiggle_offsets(ctx);
     m_surveyor_object->set_position(m_surveyor_object->get_position() + pos_offset);
     m_surveyor_object->set_rotation(m_surveyor_object->get_rotation() + rot_offset);
@@ -9,7 +9,8 @@ class Surveyor {
 public:
     Surveyor(GameObject* linked_game_object, std::vector<std::vector<double>> transition_matrix, std::vector<double> initial_state);
 
-    void move_surveyor_with_wiggle(p6::Context& ctx);
+    // keys holds the SurveyorKey bits pressed during the frame
+    void move_surveyor_with_wiggle(p6::Context& ctx, unsigned keys);
     void next_feeling();
     void adapt_feeling();
 
@@ -29,7 +30,7 @@ private:
 
     glm::vec3 m_light_intensity;
 
-    void move_surveyor(p6::Context& ctx);
+    void move_surveyor(unsigned keys);
 
     static std::pair<glm::vec3, glm::vec3> calculate_wiggle_offsets(p6::Context& ctx);
 };
@@ -5,25 +5,83 @@ layout(location = 0) in vec3 a_vertex_position;      // Vertex position
 layout(location = 1) in vec3 a_vertex_normal;        // Vertex normal
 layout(location = 2) in vec2 a_vertex_tex_coords;    // Vertex texture coordinates
 
+// Quantized meshes, see 3D_loader/vertex_packing.hpp: positions in [0, 1] of the mesh bounds, octahedral normals
+uniform vec3 u_position_min;     // Positions are u_position_min + a_vertex_position * u_position_extent
+uniform vec3 u_position_extent;
+uniform float u_normal_scale;    // Above 0, a_vertex_normal.xy holds octahedral integers up to that value
+
+// Instance attributes, only read when u_instanced is set
+layout(location = 3) in vec4 a_instance_position_scale; // World position and scale of the instance
+layout(location = 4) in vec3 a_instance_color;          // Color of the instance
+
 // Transformation matrices passed as uniforms
 uniform mat4 u_MVP_matrix;       // Model-View-Projection matrix
-uniform mat4 u_MV_matrix;        // Model-View matrix
+uniform mat4 u_MV_matrix;        // Model-View matrix, without the translation of the model when instanced
 uniform mat3 u_normal_matrix;    // Normal matrix for transforming normals
 
+uniform bool u_instanced;        // Draws the instances, see GameObject::render_instances
+uniform mat4 u_view_matrix;      // View matrix, only used when instanced
+uniform mat4 u_proj_matrix;      // Projection matrix, only used when instanced
+uniform vec3 u_color;            // Color of the object, replaced by the one of the instance
+uniform float u_outline_scale;   // Above 0, every odd copy is the outline of the previous one, see GameObject::render_game_object
+
 // Outputs to the fragment shader
 out vec3 v_position_vs;          // Transformed vertex position in view space
 out vec3 v_normal_vs;            // Transformed vertex normal in view space
 out vec2 v_tex_coords;           // Texture coordinates
+out vec3 v_color;                // Color of the object or of the instance
+flat out int v_outline;          // Set for the copies drawing the outline
+
+// Inverse of the octahedral encoding: the square [-1, 1]² unfolded onto the unit sphere
+vec3 oct_decode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+// The outline is the mesh grown around its center, pushed away from the camera along the view ray. It keeps its place
+// on screen, but lies behind the object, so that only the part around the silhouette shows: the inverted hull of the
+// former edge pass, without culling the front faces in a draw of its own.
+vec3 push_outline(vec3 object_vs, vec3 outline_vs) {
+    return outline_vs + normalize(outline_vs) * 2.0 * length(outline_vs - object_vs);
+}
 
 void main() {
+    // Decode the quantized attributes, the float meshes have a unit extent and no normal scale
+    vec3 vertex_position = u_position_min + a_vertex_position * u_position_extent;
+    vec3 vertex_normal = u_normal_scale > 0.0 ? oct_decode(a_vertex_normal.xy / u_normal_scale) : a_vertex_normal;
+
     // Convert position and normal to homogeneous coordinates
-    vec4 vertex_position_hom = vec4(a_vertex_position, 1.0);
-    vec4 vertex_normal_hom = vec4(a_vertex_normal, 0.0);
+    vec4 vertex_position_hom = vec4(vertex_position, 1.0);
+    vec4 vertex_normal_hom = vec4(vertex_normal, 0.0);
+
+    v_normal_vs = normalize(u_normal_matrix * vertex_normal); // Transform and normalize normal
+    v_tex_coords = a_vertex_tex_coords; // Pass through texture coordinates
+    v_outline = (u_outline_scale > 0.0 && gl_InstanceID % 2 == 1) ? 1 : 0;
+
+    if (u_instanced) {
+        // Rotated and scaled like the object, then moved to the instance in view space
+        vec3 instance_position_vs = vec3(u_view_matrix * vec4(a_instance_position_scale.xyz, 1.0));
+        v_position_vs = mat3(u_MV_matrix) * (vertex_position * a_instance_position_scale.w) + instance_position_vs;
+        if (v_outline == 1) {
+            vec3 outline_vs = mat3(u_MV_matrix) * (vertex_position * a_instance_position_scale.w * u_outline_scale) + instance_position_vs;
+            v_position_vs = push_outline(v_position_vs, outline_vs);
+        }
+        v_color = a_instance_color;
+        gl_Position = u_proj_matrix * vec4(v_position_vs, 1.0);
+        return;
+    }
 
     // Output calculations
     v_position_vs = vec3(u_MV_matrix * vertex_position_hom); // Transform position to view space
-    v_normal_vs = normalize(u_normal_matrix * a_vertex_normal); // Transform and normalize normal
-    v_tex_coords = a_vertex_tex_coords; // Pass through texture coordinates
+    v_color = u_color;
+
+    if (v_outline == 1) {
+        v_position_vs = push_outline(v_position_vs, vec3(u_MV_matrix * vec4(vertex_position * u_outline_scale, 1.0)));
+        gl_Position = u_proj_matrix * vec4(v_position_vs, 1.0);
+        return;
+    }
 
     // Final projected position
     gl_Position = u_MVP_matrix * vertex_position_hom;
@@ -6,7 +6,6 @@ struct Light {
 };
 
 uniform sampler2D u_texture;        // Texture sampler
-uniform vec3 u_color;               // Uniform color for non-textured rendering
 uniform bool u_use_color;           // Flag to toggle between color and texture
 
 uniform vec3 u_kd;                  // Diffuse reflectivity
@@ -18,6 +17,8 @@ uniform Light u_lights[2];
 in vec3 v_normal_vs;                // Transformed vertex normal in view space
 in vec2 v_tex_coords;               // Texture coordinates from the vertex shader
 in vec3 v_position_vs;              // Transformed vertex position in view space (should be passed from vertex shader)
+in vec3 v_color;                    // u_color, or the color of the instance
+flat in int v_outline;              // Copies drawn as the outline of the object
 
 out vec4 f_frag_color;              // Output fragment color
 
@@ -50,11 +51,11 @@ void main() {
     vec3 normal = normalize(v_normal_vs);  // Normalize the normal vector
     vec3 frag_color;
 
-    if(u_shininess == 0) {
-        f_frag_color = vec4(u_color, 1.0);
+    if(v_outline == 1) {
+        f_frag_color = vec4(0.0, 0.0, 0.0, 1.0); // Black outline
     } else {
         if(u_use_color) {
-            frag_color = u_color;  // Use the uniform color if specified
+            frag_color = v_color;  // Use the color of the object or of the instance
         } else {
             vec4 texture_color = texture(u_texture, v_tex_coords);
             frag_color = texture_color.rgb;  // Use the color from the texture
@@ -6,7 +6,6 @@ struct Light {
 };
 
 uniform sampler2D u_texture;
-uniform vec3 u_color;
 uniform bool u_use_color;
 
 uniform vec3 u_kd;
@@ -18,6 +17,8 @@ uniform Light u_lights[2];
 in vec3 v_normal_vs;
 in vec2 v_tex_coords;
 in vec3 v_position_vs;
+in vec3 v_color;
+flat in int v_outline;
 
 out vec4 f_frag_color;
 
@@ -40,11 +41,11 @@ void main() {
     vec3 normal = normalize(v_normal_vs);
     vec3 frag_color;
 
-    if(u_shininess == 0) {
-        f_frag_color = vec4(u_color, 1.0);
+    if(v_outline == 1) {
+        f_frag_color = vec4(0.0, 0.0, 0.0, 1.0); // Black outline
     } else {
         if(u_use_color) {
-            frag_color = u_color;
+            frag_color = v_color;
         } else {
             vec4 texture_color = texture(u_texture, v_tex_coords);
             frag_color = texture_color.rgb;
@@ -0,0 +1,44 @@
+#include "boid_pool.hpp"
+#include <utility>
+
+BoidPool::~BoidPool()
+{
+    free_chunks(m_chunks, m_placement);
+}
+
+void BoidPool::free_chunks(const std::vector<Boid*>& chunks, const NumaPlacement& placement)
+{
+    for (Boid* chunk : chunks)
+    {
+        deallocate_placed(chunk, chunk_bytes, placement);
+    }
+}
+
+void BoidPool::swap_remove(std::size_t index)
+{
+    if (index >= m_size)
+        return;
+    (*this)[index] = (*this)[m_size - 1];
+    m_size--;
+}
+
+void BoidPool::set_placement(const NumaPlacement& placement)
+{
+    const std::vector<Boid*> old_chunks    = std::exchange(m_chunks, {});
+    const NumaPlacement      old_placement = std::exchange(m_placement, placement);
+    const std::size_t        size          = std::exchange(m_size, 0);
+
+    spawn(size, [&](std::size_t index) { return old_chunks[index >> chunk_shift][index & chunk_mask]; });
+    free_chunks(old_chunks, old_placement);
+}
+
+NumaLocality BoidPool::measure_locality(const WorkerPool& workers) const
+{
+    NumaLocality locality;
+    for (std::size_t chunk = 0; chunk * chunk_size < m_size; chunk++)
+    {
+        const std::size_t first = chunk * chunk_size;
+        locality.merge(::measure_locality(m_chunks[chunk], first, std::min(chunk_size, m_size - first), m_size, sizeof(Boid), workers));
+    }
+    return locality;
+}
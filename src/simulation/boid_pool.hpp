@@ -0,0 +1,82 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include "numa.hpp"
+#include "scene_objects/boid.hpp"
+#include "worker_pool.hpp"
+
+// Boids in fixed-size chunks that never move once allocated: growing the flock neither copies the boids already there
+// nor invalidates pointers to them, and the cost of a spawn only depends on the boids it adds.
+// Boids stay packed in [0, size()), removals move the last boid into the hole. Chunks emptied by removals stay in the
+// pool for the next spawns.
+class BoidPool {
+public:
+    static constexpr std::size_t chunk_shift = 14;
+    static constexpr std::size_t chunk_size  = std::size_t{1} << chunk_shift;
+    static constexpr std::size_t chunk_mask  = chunk_size - 1;
+    static constexpr std::size_t chunk_bytes = chunk_size * sizeof(Boid);
+
+    BoidPool() = default;
+    ~BoidPool();
+
+    BoidPool(const BoidPool&)            = delete;
+    BoidPool& operator=(const BoidPool&) = delete;
+
+    std::size_t size() const { return m_size; }
+    bool        empty() const { return m_size == 0; }
+    std::size_t capacity() const { return m_chunks.size() * chunk_size; }
+    std::size_t get_chunk_count() const { return m_chunks.size(); }
+
+    Boid&       operator[](std::size_t index) { return m_chunks[index >> chunk_shift][index & chunk_mask]; }
+    const Boid& operator[](std::size_t index) const { return m_chunks[index >> chunk_shift][index & chunk_mask]; }
+
+    // Appends count boids, the i-th one being make(i). Each boid is written by the worker whose slice of the grown
+    // pool holds it, so new pages land on its node. make is called from several threads at once.
+    template<typename Make>
+    void spawn(std::size_t count, Make&& make)
+    {
+        const std::size_t first = m_size;
+        const std::size_t size  = m_size + count;
+        while (capacity() < size)
+        {
+            m_chunks.push_back(static_cast<Boid*>(allocate_untouched(chunk_bytes, m_placement)));
+        }
+
+        auto construct = [&](std::size_t begin, std::size_t end, std::size_t /*worker*/) {
+            for (std::size_t i = std::max(begin, first); i < end; i++)
+            {
+                ::new (&(*this)[i]) Boid(make(i - first));
+            }
+        };
+        if (m_placement.workers != nullptr)
+            m_placement.workers->parallel_for(size, construct);
+        else
+            construct(first, size, 0);
+        m_size = size;
+    }
+
+    // Removes the last count boids
+    void despawn_last(std::size_t count) { m_size -= std::min(count, m_size); }
+
+    // Removes a boid by moving the last one into its place, no other boid moves
+    void swap_remove(std::size_t index);
+
+    // Moves the boids into chunks allocated with placement, and spawns with it from now on
+    void set_placement(const NumaPlacement& placement);
+
+    NumaLocality measure_locality(const WorkerPool& workers) const;
+
+private:
+    // Boids are copied and dropped as raw memory
+    static_assert(std::is_trivially_copyable_v<Boid> && std::is_trivially_destructible_v<Boid>);
+
+    std::vector<Boid*> m_chunks;
+    std::size_t        m_size = 0;
+    NumaPlacement      m_placement;
+
+    static void free_chunks(const std::vector<Boid*>& chunks, const NumaPlacement& placement);
+};
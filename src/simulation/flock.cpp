@@ -0,0 +1,378 @@
+#include "flock.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include "maths/counter_rng.hpp"
+#include "profiling/profiler.hpp"
+
+unsigned active_rules(const BoidVariables& variables)
+{
+    unsigned rules = 0;
+    if (variables.align > 0.f)
+        rules |= RULE_ALIGN;
+    if (variables.cohesion > 0.f)
+        rules |= RULE_COHESION;
+    if (variables.separate > 0.f)
+        rules |= RULE_SEPARATE;
+
+    // Neighbor rules only look at boids inside the radius of awareness
+    if (variables.radius_awareness <= 0.f)
+        rules &= ~NEIGHBOR_RULES;
+
+    if (variables.flow > 0.f)
+        rules |= RULE_FLOW;
+    return rules;
+}
+
+Flock::Flock(std::size_t boid_count)
+    : m_partials(m_workers.get_worker_count())
+{
+    place_arrays({&m_workers, m_variables.huge_pages});
+    spawn(boid_count, 2.f);
+    set_variables(m_variables);
+}
+
+// Moves the arrays into memory allocated with placement, the move assignments carry the new allocator along
+void Flock::place_arrays(const NumaPlacement& placement)
+{
+    m_placement = placement;
+    m_boids.set_placement(placement);
+
+    m_positions          = NumaVector<glm::vec3>(NumaAllocator<glm::vec3>(placement));
+    m_steered_velocities = NumaVector<glm::vec3>(NumaAllocator<glm::vec3>(placement));
+    m_neighbor_list.set_placement(placement);
+}
+
+void Flock::spawn(std::size_t count)
+{
+    spawn(count, m_variables.cube_length);
+}
+
+void Flock::spawn(std::size_t count, float half_extent)
+{
+    PROFILE_ZONE("Spawn");
+
+    // Positions in [-half_extent, half_extent] and velocities in [-4, 4] like Boid(), from one batch of draws keyed by
+    // rand(), so a seed still gives the same flock. Colors still come from rand() one after the other, the boids are then
+    // written in parallel.
+    std::vector<float> draws(count * 6);
+    CounterRng(static_cast<std::uint64_t>(rand()), 0).fill(draws);
+    std::vector<Color> colors(count);
+    std::generate(colors.begin(), colors.end(), generate_vivid_color);
+
+    m_boids.spawn(count, [&](std::size_t i) {
+        const float* draw = &draws[i * 6];
+        return Boid((glm::vec3(draw[0], draw[1], draw[2]) * 2.f - 1.f) * half_extent, glm::vec3(draw[3], draw[4], draw[5]) * 8.f - 4.f, colors[i]);
+    });
+    m_population++;
+}
+
+void Flock::despawn(std::size_t count)
+{
+    m_boids.despawn_last(count);
+    m_population++;
+    if (m_slice_cursor >= m_boids.size())
+        m_slice_cursor = 0;
+}
+
+void Flock::despawn_at(std::size_t index)
+{
+    m_boids.swap_remove(index);
+    m_population++;
+    if (m_slice_cursor >= m_boids.size())
+        m_slice_cursor = 0;
+}
+
+void Flock::set_boid_count(std::size_t count)
+{
+    if (count > m_boids.size())
+        spawn(count - m_boids.size());
+    else
+        despawn(m_boids.size() - count);
+}
+
+void Flock::set_variables(const BoidVariables& variables)
+{
+    if (variables.huge_pages != m_placement.huge_pages)
+    {
+        place_arrays({&m_workers, variables.huge_pages});
+    }
+
+    m_variables    = variables;
+    m_active_rules = active_rules(variables);
+    m_step_kernel  = Boid::kernel_for(m_active_rules, variables.sample_neighbors);
+}
+
+void Flock::steer_all()
+{
+    m_workers.parallel_for(m_boids.size(), [&](std::size_t begin, std::size_t end, std::size_t worker) {
+        FlockStatistics& statistics = m_partials[worker].statistics;
+        for (std::size_t i = begin; i < end; i++)
+        {
+            m_steered_velocities[i] = (m_boids[i].*m_step_kernel)(i, m_boids, m_search, m_flow_field, m_variables, statistics);
+        }
+    });
+
+    for (std::size_t i = 0; i < m_boids.size(); i++)
+    {
+        m_boids[i].set_velocity(m_steered_velocities[i]);
+    }
+}
+
+void Flock::steer_time_sliced()
+{
+    using clock                      = std::chrono::steady_clock;
+    constexpr std::size_t batch_size = 32;
+
+    // The clock is only read between batches, and the first batch always runs so the flock never starves
+    const auto        deadline   = clock::now() + std::chrono::microseconds(m_variables.step_budget_us);
+    const std::size_t first      = m_slice_cursor;
+    std::size_t       steered    = 0;
+    FlockStatistics&  statistics = m_partials[0].statistics;
+    do
+    {
+        for (std::size_t i = 0; i < batch_size && steered < m_boids.size(); i++, steered++)
+        {
+            m_steered_velocities[m_slice_cursor] = (m_boids[m_slice_cursor].*m_step_kernel)(m_slice_cursor, m_boids, m_search, m_flow_field, m_variables, statistics);
+            m_slice_cursor                       = (m_slice_cursor + 1) % m_boids.size();
+        }
+    } while (steered < m_boids.size() && clock::now() < deadline);
+
+    for (std::size_t i = 0; i < steered; i++)
+    {
+        const std::size_t index = (first + i) % m_boids.size();
+        m_boids[index].set_velocity(m_steered_velocities[index]);
+    }
+}
+
+void Flock::build_grid(float radius)
+{
+    m_search = {};
+    if (m_variables.unbounded_world)
+    {
+        m_sparse_grid.build(m_positions, radius);
+        m_search.sparse_grid = &m_sparse_grid;
+    }
+    else
+    {
+        m_grid.build(m_positions, m_variables.cube_length, radius);
+        m_search.grid = &m_grid;
+    }
+}
+
+void Flock::prepare_neighbor_search()
+{
+    const float radius = m_variables.radius_awareness;
+    if (!m_variables.verlet_lists)
+    {
+        build_grid(radius);
+        record_occupancy();
+        return;
+    }
+
+    // The grid is only needed to rebuild the lists, with cells wide enough for the skin.
+    // Roaming boids still search the grid of the last build, which must be the one of the current world.
+    const float skin           = m_variables.verlet_skin;
+    const bool  same_structure = m_search.list != nullptr && m_variables.unbounded_world == (m_search.sparse_grid != nullptr);
+    if (m_neighbor_list.update(m_positions, radius, skin, m_workers) || !same_structure)
+    {
+        build_grid(radius + skin);
+        if (!lists_fit_density())
+        {
+            // Searches the grid this step, the lists are tried again at the next one
+            record_occupancy();
+            return;
+        }
+        if (m_search.sparse_grid != nullptr)
+            m_neighbor_list.build(m_positions, m_sparse_grid, radius, skin, m_workers);
+        else
+            m_neighbor_list.build(m_positions, m_grid, radius, skin, m_workers);
+        m_neighbor_list_age = 0;
+    }
+    else
+    {
+        m_neighbor_list_age++;
+    }
+    record_occupancy();
+    m_search.list                      = &m_neighbor_list;
+    m_statistics.neighbor_lists        = true;
+    m_statistics.neighbor_list_age     = m_neighbor_list_age;
+    m_statistics.neighbor_list_entries = m_neighbor_list.get_entry_count();
+}
+
+// Lists hold every boid within radius + skin, in a dense flock such as a large spawn they would take more memory and
+// time to build than searching the grid, which stops at max_neighbors
+bool Flock::lists_fit_density() const
+{
+    constexpr std::size_t samples = 64;
+    const std::size_t     stride  = std::max<std::size_t>(m_positions.size() / samples, 1);
+    std::size_t           sampled = 0;
+    std::size_t           total   = 0;
+    for (std::size_t i = 0; i < m_positions.size(); i += stride, sampled++)
+    {
+        total += m_search.count_candidates(i, m_positions[i]);
+    }
+    return total <= max_list_candidates * sampled;
+}
+
+void Flock::record_occupancy()
+{
+    if (m_search.sparse_grid != nullptr)
+        m_sparse_grid.record_occupancy(m_statistics);
+    else
+        m_grid.record_occupancy(m_statistics);
+}
+
+void Flock::update()
+{
+    m_positions.resize(m_boids.size());
+    m_steered_velocities.resize(m_boids.size());
+    m_workers.parallel_for(m_boids.size(), [&](std::size_t begin, std::size_t end, std::size_t /*worker*/) {
+        for (std::size_t i = begin; i < end; i++)
+        {
+            m_positions[i] = m_boids[i].get_position();
+        }
+    });
+
+    for (auto& partial : m_partials)
+    {
+        partial.statistics               = FlockStatistics{};
+        partial.statistics.histogram_max = m_variables.max_neighbors;
+    }
+    m_statistics               = FlockStatistics{};
+    m_statistics.histogram_max = m_variables.max_neighbors;
+    prepare_neighbor_search();
+    m_search.sample_size   = static_cast<float>(std::max(m_variables.sample_size, 1));
+    m_search.sampling_seed = m_step;
+    if ((m_active_rules & RULE_FLOW) != 0)
+    {
+        m_flow_field.update(m_flow_targets, m_variables.cube_length);
+    }
+    m_statistics.pool_chunks       = m_boids.get_chunk_count();
+    m_statistics.pool_capacity     = m_boids.capacity();
+    m_statistics.flow_field_builds = m_flow_field.get_build_count();
+    m_statistics.flow_field_ms     = m_flow_field.get_build_ms();
+
+    if (!m_boids.empty())
+    {
+        if (m_variables.time_sliced)
+            steer_time_sliced();
+        else
+            steer_all();
+    }
+
+    for (const auto& partial : m_partials)
+    {
+        m_statistics.merge(partial.statistics);
+    }
+
+    m_workers.parallel_for(m_boids.size(), [&](std::size_t begin, std::size_t end, std::size_t /*worker*/) {
+        for (std::size_t i = begin; i < end; i++)
+        {
+            m_boids[i].integrate(m_variables);
+        }
+    });
+    m_step++;
+}
+
+void Flock::write_snapshot(FlockSnapshot& snapshot) const
+{
+    snapshot.positions.resize(m_boids.size());
+    snapshot.colors.resize(m_boids.size());
+    for (std::size_t i = 0; i < m_boids.size(); i++)
+    {
+        snapshot.positions[i] = m_boids[i].get_position();
+        snapshot.colors[i]    = m_boids[i].get_color();
+    }
+    snapshot.index.build(snapshot.positions, m_variables.cube_length, m_variables.unbounded_world);
+
+    snapshot.step        = m_step;
+    snapshot.population  = m_population;
+    snapshot.statistics  = m_statistics;
+    snapshot.time_sliced = m_variables.time_sliced;
+}
+
+NumaLocality Flock::measure_locality() const
+{
+    NumaLocality locality = m_boids.measure_locality(m_workers);
+    locality.merge(::measure_locality(m_positions.data(), m_positions.size(), sizeof(glm::vec3), m_workers));
+    locality.merge(::measure_locality(m_steered_velocities.data(), m_steered_velocities.size(), sizeof(glm::vec3), m_workers));
+    locality.merge(m_neighbor_list.measure_locality(m_workers));
+    return locality;
+}
+
+// Searches around the current positions, as the next update would, without changing the statistics of the last one
+void Flock::prepare_measurement()
+{
+    const FlockStatistics statistics = m_statistics;
+    m_positions.resize(m_boids.size());
+    for (std::size_t i = 0; i < m_boids.size(); i++)
+    {
+        m_positions[i] = m_boids[i].get_position();
+    }
+    prepare_neighbor_search();
+    m_statistics = statistics;
+}
+
+double Flock::steer_with(Boid::StepKernel kernel, std::vector<glm::vec3>& velocities)
+{
+    std::vector<PartialStatistics> partials(m_workers.get_worker_count());
+    velocities.resize(m_boids.size());
+    const auto start_time = std::chrono::steady_clock::now();
+    m_workers.parallel_for(m_boids.size(), [&](std::size_t begin, std::size_t end, std::size_t worker) {
+        for (std::size_t i = begin; i < end; i++)
+        {
+            velocities[i] = (m_boids[i].*kernel)(i, m_boids, m_search, m_flow_field, m_variables, partials[worker].statistics);
+        }
+    });
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+SamplingError Flock::measure_sampling_error(int sample_size)
+{
+    prepare_measurement();
+    m_search.sample_size   = static_cast<float>(std::max(sample_size, 1));
+    m_search.sampling_seed = m_step;
+
+    std::vector<glm::vec3> exact;
+    std::vector<glm::vec3> sampled;
+    SamplingError          error;
+    error.sample_size = sample_size;
+    error.exact_ms    = steer_with(Boid::kernel_for(m_active_rules, false), exact);
+    error.sampled_ms  = steer_with(Boid::kernel_for(m_active_rules, true), sampled);
+
+    // Velocity changes can cancel out once the flock settles, so errors are measured against the speeds
+    double difference = 0.;
+    double speed      = 0.;
+    for (std::size_t i = 0; i < m_boids.size(); i++)
+    {
+        difference += glm::length(sampled[i] - exact[i]);
+        speed += glm::length(exact[i]);
+    }
+    error.relative_error = speed > 0. ? static_cast<float>(difference / speed) : 0.f;
+    return error;
+}
+
+std::vector<IsaKernelTiming> Flock::measure_isa_kernels()
+{
+    prepare_measurement();
+
+    std::vector<glm::vec3>       reference;
+    std::vector<glm::vec3>       velocities;
+    std::vector<IsaKernelTiming> timings;
+    const double                 portable_ms = steer_with(Boid::kernel_for(m_active_rules, false, Isa::Portable), reference);
+    timings.push_back({Isa::Portable, portable_ms, 0.f});
+    for (Isa isa : {Isa::Avx2, Isa::Avx512})
+    {
+        if (isa > detect_isa())
+            break;
+
+        IsaKernelTiming timing{isa, steer_with(Boid::kernel_for(m_active_rules, false, isa), velocities), 0.f};
+        for (std::size_t i = 0; i < m_boids.size(); i++)
+        {
+            timing.max_difference = std::max(timing.max_difference, glm::length(velocities[i] - reference[i]));
+        }
+        timings.push_back(timing);
+    }
+    return timings;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "boid_pool.hpp"
+#include "flock_snapshot.hpp"
+#include "flock_statistics.hpp"
+#include "flow_field.hpp"
+#include "neighbor_list.hpp"
+#include "neighbor_search.hpp"
+#include "numa.hpp"
+#include "scene_objects/boid.hpp"
+#include "sparse_grid.hpp"
+#include "spatial_grid.hpp"
+#include "worker_pool.hpp"
+
+// Steering with neighbor sampling compared to the exact one, see Flock::measure_sampling_error
+struct SamplingError {
+    int    sample_size    = 0;
+    float  relative_error = 0.f; // Sum of the velocity errors over the sum of the exact speeds
+    double exact_ms       = 0.;
+    double sampled_ms     = 0.;
+};
+
+// Exact steering of the copy of the step kernel compiled for isa, see Flock::measure_isa_kernels
+struct IsaKernelTiming {
+    Isa    isa            = Isa::Portable;
+    double step_ms        = 0.;
+    float  max_difference = 0.f; // Largest velocity difference with the portable kernel, from contracted multiply-adds
+};
+
+class Flock {
+public:
+    explicit Flock(std::size_t boid_count);
+
+    // Selects the step kernel matching the rules that currently have a non-zero weight
+    void set_variables(const BoidVariables& variables);
+
+    // Adds boids anywhere in the cube, the initial ones start near its center. Boids already there do not move in memory.
+    void spawn(std::size_t count);
+    // Removes the last count boids
+    void despawn(std::size_t count);
+    // Removes one boid, the last boid takes its index
+    void despawn_at(std::size_t index);
+    void set_boid_count(std::size_t count);
+
+    // Goal and obstacles of the flow field, which is only computed again when they change
+    void set_flow_targets(const FlowTargets& targets) { m_flow_targets = targets; }
+
+    // Steers every boid in parallel, or in time-sliced mode the next boids in round-robin order until the step budget is spent.
+    // Every boid reads the state of the previous step, then all of them are integrated so the whole flock keeps moving.
+    void update();
+
+    const BoidPool&       get_boids() const { return m_boids; }
+    const BoidVariables&  get_variables() const { return m_variables; }
+    unsigned              get_active_rules() const { return m_active_rules; }
+    const WorkerPool&     get_workers() const { return m_workers; }
+
+    // Aggregates of the last update, gathered by the step kernels themselves
+    const FlockStatistics& get_statistics() const { return m_statistics; }
+
+    std::uint64_t get_step() const { return m_step; }
+
+    void write_snapshot(FlockSnapshot& snapshot) const;
+
+    // Steers the flock as it is with and without neighbor sampling, without applying the result
+    SamplingError measure_sampling_error(int sample_size);
+
+    // Steers the flock as it is with each copy of the step kernel the CPU can run, without applying the result
+    std::vector<IsaKernelTiming> measure_isa_kernels();
+
+    // Share of the pages of the flock arrays that sit on the node of the worker using them
+    NumaLocality measure_locality() const;
+
+private:
+    // Mean candidates per boid in the cells around it above which the Verlet lists are not built
+    static constexpr std::size_t max_list_candidates = 1024;
+
+    // One partial reduction per worker, each on its own cache lines
+    struct alignas(64) PartialStatistics {
+        FlockStatistics statistics;
+    };
+
+    WorkerPool                     m_workers; // First, the arrays below are placed by its workers
+    NumaPlacement                  m_placement;
+    BoidPool                       m_boids;
+    NumaVector<glm::vec3>          m_positions;
+    NumaVector<glm::vec3>          m_steered_velocities;
+    SpatialGrid                    m_grid;
+    SparseGrid                     m_sparse_grid; // Replaces m_grid in an unbounded world
+    NeighborList                   m_neighbor_list;
+    NeighborSearch                 m_search;
+    FlowTargets                    m_flow_targets;
+    FlowField                      m_flow_field;
+    std::vector<PartialStatistics> m_partials;
+    FlockStatistics                m_statistics;
+    BoidVariables                  m_variables;
+    unsigned                       m_active_rules      = 0;
+    Boid::StepKernel               m_step_kernel       = nullptr;
+    std::size_t                    m_slice_cursor      = 0; // Next boid to steer in time-sliced mode
+    std::uint64_t                  m_neighbor_list_age = 0;
+    std::uint64_t                  m_step              = 0;
+    std::uint64_t                  m_population        = 0; // Counts the spawns and despawns, see FlockSnapshot::population
+
+    void   spawn(std::size_t count, float half_extent);
+    void   place_arrays(const NumaPlacement& placement);
+    void   build_grid(float radius);
+    void   record_occupancy();
+    bool   lists_fit_density() const;
+    void   prepare_neighbor_search();
+    void   steer_all();
+    void   steer_time_sliced();
+    void   prepare_measurement();
+    double steer_with(Boid::StepKernel kernel, std::vector<glm::vec3>& velocities);
+};
+
+unsigned active_rules(const BoidVariables& variables);
@@ -0,0 +1,141 @@
+#include "flock_index.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+void FlockIndex::build(std::span<const glm::vec3> positions, float half_extent, bool unbounded)
+{
+    m_unbounded = unbounded;
+    if (m_unbounded)
+        m_sparse_grid.build(positions, cell_size);
+    else
+        m_grid.build(positions, half_extent, cell_size);
+}
+
+// Distance along the ray to where it enters the sphere, 0 when it starts inside, or a negative value when it misses
+static float ray_sphere(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& center, float radius)
+{
+    const glm::vec3 to_center = center - origin;
+    const float     closest   = glm::dot(to_center, direction);
+    const float     miss2     = glm::dot(to_center, to_center) - closest * closest;
+    if (miss2 > radius * radius)
+        return -1.f;
+
+    const float half_chord = std::sqrt(radius * radius - miss2);
+    if (closest + half_chord < 0.f)
+        return -1.f;
+    return std::max(closest - half_chord, 0.f);
+}
+
+// Walks the cells the ray crosses between t_start and t_end with a 3D DDA, for hits up to max_distance.
+// Boids within boid_radius of the ray are at most one cell away from a crossed cell, so the 27 cells around the first
+// one are searched, then at each step only the layer of 9 cells that enters the neighborhood: no cell is searched twice.
+// The walk stops once no boid further along can be nearer than the best hit.
+template<typename Grid>
+static std::optional<RayHit> walk_cells(const Grid& grid, std::span<const glm::vec3> positions, const glm::vec3& origin, const glm::vec3& direction, float t_start, float t_end, float max_distance, float boid_radius)
+{
+    const glm::vec3 start     = grid.grid_coordinates(origin + direction * t_start);
+    const float     inv_size  = 1.f / grid.get_cell_size();
+    const float     infinity  = std::numeric_limits<float>::infinity();
+    glm::ivec3      cell(glm::floor(start));
+    glm::ivec3      step(0);
+    glm::vec3       t_next(infinity); // Distance at which the ray enters the next cell along each axis
+    glm::vec3       t_delta(infinity);
+    for (int axis = 0; axis < 3; axis++)
+    {
+        const float cells_per_unit = direction[axis] * inv_size;
+        if (cells_per_unit > 0.f)
+        {
+            step[axis]    = 1;
+            t_next[axis]  = t_start + (static_cast<float>(cell[axis] + 1) - start[axis]) / cells_per_unit;
+            t_delta[axis] = 1.f / cells_per_unit;
+        }
+        else if (cells_per_unit < 0.f)
+        {
+            step[axis]    = -1;
+            t_next[axis]  = t_start + (start[axis] - static_cast<float>(cell[axis])) / -cells_per_unit;
+            t_delta[axis] = -1.f / cells_per_unit;
+        }
+    }
+
+    std::optional<RayHit> hit;
+    auto                  test = [&](std::uint32_t index) {
+        const float distance = ray_sphere(origin, direction, positions[index], boid_radius);
+        if (distance >= 0.f && distance <= max_distance && (!hit || distance < hit->distance))
+            hit = RayHit{index, distance};
+    };
+
+    for (const glm::ivec3& offset : SpatialGrid::near_to_far_offsets)
+    {
+        grid.visit_cell(cell + offset, test);
+    }
+    while (true)
+    {
+        const int   axis    = t_next.x < t_next.y ? (t_next.x < t_next.z ? 0 : 2) : (t_next.y < t_next.z ? 1 : 2);
+        const float t_enter = t_next[axis];
+        // Boids first met from this cell on enter the ray at t_enter - boid_radius at best
+        if (t_enter > t_end + boid_radius || (hit && t_enter - boid_radius > hit->distance))
+            break;
+
+        cell[axis] += step[axis];
+        t_next[axis] += t_delta[axis];
+
+        glm::ivec3 layer = cell;
+        layer[axis] += step[axis];
+        const int u = (axis + 1) % 3;
+        const int v = (axis + 2) % 3;
+        for (int i = -1; i <= 1; i++)
+        {
+            for (int j = -1; j <= 1; j++)
+            {
+                glm::ivec3 neighbor = layer;
+                neighbor[u] += i;
+                neighbor[v] += j;
+                grid.visit_cell(neighbor, test);
+            }
+        }
+    }
+    return hit;
+}
+
+std::optional<RayHit> FlockIndex::raycast(std::span<const glm::vec3> positions, const glm::vec3& origin, const glm::vec3& direction, float max_distance, float boid_radius) const
+{
+    if (m_unbounded)
+        return walk_cells(m_sparse_grid, positions, origin, direction, 0.f, max_distance, max_distance, boid_radius);
+
+    // Clips the ray to the cube grown by one cell, where the boids at its border can stand
+    const float bound   = m_grid.get_half_extent() + m_grid.get_cell_size();
+    float       t_start = 0.f;
+    float       t_end   = max_distance;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (direction[axis] == 0.f)
+        {
+            if (std::abs(origin[axis]) > bound)
+                return std::nullopt;
+            continue;
+        }
+        const float t0 = (-bound - origin[axis]) / direction[axis];
+        const float t1 = (bound - origin[axis]) / direction[axis];
+        t_start        = std::max(t_start, std::min(t0, t1));
+        t_end          = std::min(t_end, std::max(t0, t1));
+    }
+    if (t_start > t_end)
+        return std::nullopt;
+
+    return walk_cells(m_grid, positions, origin, direction, t_start, t_end, max_distance, boid_radius);
+}
+
+std::size_t FlockIndex::count_in_sphere(std::span<const glm::vec3> positions, const glm::vec3& center, float radius) const
+{
+    std::size_t count = 0;
+    query_sphere(positions, center, radius, [&](std::uint32_t) { count++; });
+    return count;
+}
+
+std::size_t FlockIndex::count_in_box(std::span<const glm::vec3> positions, const glm::vec3& min, const glm::vec3& max) const
+{
+    std::size_t count = 0;
+    query_box(positions, min, max, [&](std::uint32_t) { count++; });
+    return count;
+}
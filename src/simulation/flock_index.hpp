@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include "glm/glm.hpp"
+#include "sparse_grid.hpp"
+#include "spatial_grid.hpp"
+
+struct RayHit {
+    std::uint32_t index;
+    float         distance; // Along the ray, to where it enters the sphere of the boid
+};
+
+// Ray, sphere and box queries over the positions of a snapshot, for picking boids and counting them inside regions.
+// Queries only go through the cells their shape overlaps, so they cost the same for a hundred or a hundred thousand boids.
+// Space is indexed like the simulation indexes it: a dense grid over the cube, or a sparse one in an unbounded world.
+class FlockIndex {
+public:
+    static constexpr float cell_size = 1.f; // Independent of the radius of awareness, which can be zero
+
+    void build(std::span<const glm::vec3> positions, float half_extent, bool unbounded);
+
+    // Nearest boid, seen as a sphere of boid_radius, that the ray crosses within max_distance.
+    // direction is normalized and boid_radius is at most cell_size.
+    // In the cube, boids more than one cell outside of it are not found: the dense grid keeps them in its border cells.
+    std::optional<RayHit> raycast(std::span<const glm::vec3> positions, const glm::vec3& origin, const glm::vec3& direction, float max_distance, float boid_radius) const;
+
+    // Calls visitor(index) for every boid inside the sphere
+    template<typename Visitor>
+    void query_sphere(std::span<const glm::vec3> positions, const glm::vec3& center, float radius, Visitor&& visitor) const
+    {
+        visit_cells(center - radius, center + radius, [&](std::uint32_t index) {
+            const glm::vec3 offset = positions[index] - center;
+            if (glm::dot(offset, offset) <= radius * radius)
+                visitor(index);
+        });
+    }
+
+    // Calls visitor(index) for every boid inside the axis-aligned box
+    template<typename Visitor>
+    void query_box(std::span<const glm::vec3> positions, const glm::vec3& min, const glm::vec3& max, Visitor&& visitor) const
+    {
+        visit_cells(min, max, [&](std::uint32_t index) {
+            const glm::vec3& p = positions[index];
+            if (p.x >= min.x && p.y >= min.y && p.z >= min.z && p.x <= max.x && p.y <= max.y && p.z <= max.z)
+                visitor(index);
+        });
+    }
+
+    std::size_t count_in_sphere(std::span<const glm::vec3> positions, const glm::vec3& center, float radius) const;
+    std::size_t count_in_box(std::span<const glm::vec3> positions, const glm::vec3& min, const glm::vec3& max) const;
+
+private:
+    SpatialGrid m_grid;
+    SparseGrid  m_sparse_grid; // Replaces m_grid in an unbounded world
+    bool        m_unbounded = false;
+
+    // Calls visitor(index) for the boids of the cells overlapping the box, in the cube the border cells also hold the boids outside
+    template<typename Visitor>
+    void visit_cells(const glm::vec3& min, const glm::vec3& max, Visitor&& visitor) const
+    {
+        if (m_unbounded)
+            visit_cell_range(m_sparse_grid, m_sparse_grid.cell_of(min), m_sparse_grid.cell_of(max), visitor);
+        else
+            visit_cell_range(m_grid, m_grid.cell_of(min), m_grid.cell_of(max), visitor);
+    }
+
+    template<typename Grid, typename Visitor>
+    static void visit_cell_range(const Grid& grid, const glm::ivec3& first, const glm::ivec3& last, Visitor& visitor)
+    {
+        for (int z = first.z; z <= last.z; z++)
+            for (int y = first.y; y <= last.y; y++)
+                for (int x = first.x; x <= last.x; x++)
+                    grid.visit_cell(glm::ivec3(x, y, z), visitor);
+    }
+};
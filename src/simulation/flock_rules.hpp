@@ -0,0 +1,16 @@
+#pragma once
+
+// Steering rules of a flock step, one bit each.
+// A new rule takes the next bit and bumps RULE_COUNT: every combination then gets its own kernel.
+enum FlockRule : unsigned {
+    RULE_ALIGN    = 1u << 0,
+    RULE_COHESION = 1u << 1,
+    RULE_SEPARATE = 1u << 2,
+    RULE_FLOW     = 1u << 3, // Follow the flow field toward the goal
+};
+
+constexpr unsigned RULE_COUNT        = 4;
+constexpr unsigned RULE_COMBINATIONS = 1u << RULE_COUNT;
+
+// Rules that need a pass over the neighbors
+constexpr unsigned NEIGHBOR_RULES = RULE_ALIGN | RULE_COHESION | RULE_SEPARATE;
@@ -0,0 +1,12 @@
+#include "flock_snapshot.hpp"
+#include "p6/p6.h"
+
+void FlockSnapshot::draw_Gui() const
+{
+    ImGui::Text("Simulation step %llu: %.3f ms", static_cast<unsigned long long>(step), step_ms);
+    if (time_sliced)
+    {
+        ImGui::Text("Steered this step: %zu / %zu boids", statistics.steered_count, positions.size());
+    }
+    statistics.draw_Gui();
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "flock_index.hpp"
+#include "flock_statistics.hpp"
+#include "maths/color.hpp"
+
+// Immutable state of the flock after one step, everything the renderer and the GUI need
+struct FlockSnapshot {
+    std::vector<glm::vec3> positions;
+    std::vector<Color>     colors;
+    FlockIndex             index; // Over positions, so the renderer can pick and count boids without scanning them
+
+    std::uint64_t   step       = 0;
+    std::uint64_t   population = 0; // Changes whenever boids are spawned or despawned, indices of before may name other boids
+    double          step_ms    = 0.;
+    FlockStatistics statistics;
+    bool            time_sliced = false;
+
+    void draw_Gui() const;
+};
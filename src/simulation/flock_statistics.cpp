@@ -0,0 +1,48 @@
+#include "flock_statistics.hpp"
+#include <algorithm>
+#include "p6/p6.h"
+
+void FlockStatistics::merge(const FlockStatistics& other)
+{
+    steered_count += other.steered_count;
+    capped_count += other.capped_count;
+    neighbor_sum += other.neighbor_sum;
+    heading_sum += other.heading_sum;
+    for (std::size_t bin = 0; bin < histogram_bins; bin++)
+    {
+        neighbor_histogram[bin] += other.neighbor_histogram[bin];
+    }
+}
+
+float FlockStatistics::polarization() const
+{
+    return steered_count == 0 ? 0.f : glm::length(heading_sum) / static_cast<float>(steered_count);
+}
+
+float FlockStatistics::mean_neighbor_count() const
+{
+    return steered_count == 0 ? 0.f : static_cast<float>(neighbor_sum) / static_cast<float>(steered_count);
+}
+
+void FlockStatistics::draw_Gui() const
+{
+    const float capped_ratio = steered_count == 0 ? 0.f : static_cast<float>(capped_count) / static_cast<float>(steered_count);
+    ImGui::Text("Neighbor cap hit: %zu / %zu boids (%.1f%%)", capped_count, steered_count, capped_ratio * 100.f);
+    ImGui::Text("Polarization: %.3f", polarization());
+    ImGui::Text("Mean neighbor count: %.2f", mean_neighbor_count());
+
+    std::array<float, histogram_bins> histogram{};
+    std::copy(neighbor_histogram.begin(), neighbor_histogram.end(), histogram.begin());
+    ImGui::PlotHistogram("Neighbors", histogram.data(), static_cast<int>(histogram_bins), 0, nullptr, 0.f, static_cast<float>(std::max<std::size_t>(steered_count, 1)), {0.f, 60.f});
+    ImGui::Text("Boid pool: %zu chunks, room for %zu boids", pool_chunks, pool_capacity);
+    ImGui::Text("Grid: %zu / %zu cells occupied, up to %zu boids per cell", occupied_cells, cell_count, max_cell_occupancy);
+    ImGui::Text("Grid memory: %.1f KiB", static_cast<float>(grid_bytes) / 1024.f);
+    if (neighbor_lists)
+    {
+        ImGui::Text("Neighbor lists: %zu entries, rebuilt %llu steps ago", neighbor_list_entries, static_cast<unsigned long long>(neighbor_list_age));
+    }
+    if (flow_field_builds > 0)
+    {
+        ImGui::Text("Flow field: %llu builds, last one took %.2f ms", static_cast<unsigned long long>(flow_field_builds), flow_field_ms);
+    }
+}
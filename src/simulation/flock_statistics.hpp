@@ -0,0 +1,62 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "glm/glm.hpp"
+
+// Aggregates gathered by the step kernels while they visit neighbors, so monitoring needs no extra pass over the flock.
+// Each worker fills its own partial, which are merged once the step is done.
+struct FlockStatistics {
+    static constexpr std::size_t histogram_bins = 16;
+
+    std::size_t steered_count = 0;
+    std::size_t capped_count  = 0;
+    std::size_t neighbor_sum  = 0;
+    glm::vec3   heading_sum{0.f}; // Sum of the unit velocities
+
+    int                                       histogram_max = 1; // Neighbor count covered by the last bin
+    std::array<std::uint32_t, histogram_bins> neighbor_histogram{};
+
+    // Storage of the boids, see BoidPool
+    std::size_t pool_chunks   = 0;
+    std::size_t pool_capacity = 0;
+
+    // Filled by the grid build
+    std::size_t cell_count         = 0;
+    std::size_t occupied_cells     = 0;
+    std::size_t max_cell_occupancy = 0;
+    std::size_t grid_bytes         = 0;
+
+    // Verlet lists, age 0 means they were rebuilt during this step
+    bool          neighbor_lists        = false;
+    std::uint64_t neighbor_list_age     = 0;
+    std::size_t   neighbor_list_entries = 0;
+
+    // Flow field, builds counted since the flock was created
+    std::uint64_t flow_field_builds = 0;
+    double        flow_field_ms     = 0.; // Duration of the last build
+
+    void add_boid(int neighbor_count, bool capped, const glm::vec3& velocity)
+    {
+        steered_count++;
+        capped_count += capped;
+        neighbor_sum += static_cast<std::size_t>(neighbor_count);
+
+        const float speed = glm::length(velocity);
+        if (speed > 0.f)
+            heading_sum += velocity / speed;
+
+        const std::size_t bin = static_cast<std::size_t>(neighbor_count) * histogram_bins / static_cast<std::size_t>(histogram_max + 1);
+        neighbor_histogram[std::min(bin, histogram_bins - 1)]++;
+    }
+
+    void merge(const FlockStatistics& other);
+
+    // 1 when every steered boid heads the same way, close to 0 for random headings
+    float polarization() const;
+    float mean_neighbor_count() const;
+
+    void draw_Gui() const;
+};
@@ -0,0 +1,93 @@
+#include "flock_stream_client.hpp"
+#include <iostream>
+#include "p6/p6.h"
+#include "profiling/profiler.hpp"
+#include "stream_socket.hpp"
+
+FlockStreamClient::~FlockStreamClient()
+{
+    disconnect();
+}
+
+bool FlockStreamClient::connect(const std::string& address)
+{
+    disconnect();
+    m_socket = connect_to(address);
+    if (m_socket < 0)
+        return false;
+
+    m_address = address;
+    m_connected.store(true, std::memory_order_relaxed);
+    m_thread = std::jthread([this](std::stop_token stop_token) { run(stop_token); });
+    std::cout << "Viewing the flock streamed on " << address << std::endl;
+    return true;
+}
+
+void FlockStreamClient::disconnect()
+{
+    if (m_socket < 0)
+        return;
+
+    // Wakes up the receive thread if it is waiting for a frame
+    m_thread.request_stop();
+    shutdown_socket(m_socket);
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+    close_socket(m_socket);
+    m_socket = -1;
+    m_connected.store(false, std::memory_order_relaxed);
+}
+
+const FlockSnapshot& FlockStreamClient::latest_snapshot()
+{
+    m_snapshots.fetch();
+    return m_snapshots.read_buffer();
+}
+
+void FlockStreamClient::run(std::stop_token stop_token)
+{
+    Profiler::set_thread_name("Stream");
+    FlockStreamHeader header;
+    while (!stop_token.stop_requested() && receive_all(m_socket, &header, sizeof(header)))
+    {
+        if (header.magic != FlockStreamHeader::expected_magic || header.version != FlockStreamHeader::expected_version)
+        {
+            std::cerr << "Error: " << m_address << " does not send a flock stream of version " << FlockStreamHeader::expected_version << std::endl;
+            break;
+        }
+        // The stream cannot be resynchronized once a header is wrong
+        if (const char* error = flock_stream_header_error(header))
+        {
+            std::cerr << "Error: " << error << " in the flock stream of " << m_address << " at step " << header.step << std::endl;
+            break;
+        }
+        m_payload.resize(header.payload_bytes);
+        if (!receive_all(m_socket, m_payload.data(), m_payload.size()))
+            break;
+
+        PROFILE_ZONE("Stream decode");
+        if (!m_decoder.decode(header, m_payload, m_snapshots.write_buffer()))
+            continue;
+        m_snapshots.publish();
+
+        m_frame_count.fetch_add(1, std::memory_order_relaxed);
+        if (header.type == FlockStreamFrameType::Keyframe)
+            m_keyframe_count.fetch_add(1, std::memory_order_relaxed);
+        if (header.boid_count > 0)
+            m_bytes_per_boid.store(static_cast<double>(sizeof(header) + header.payload_bytes) / header.boid_count, std::memory_order_relaxed);
+    }
+    if (!stop_token.stop_requested())
+        std::cout << "The server of " << m_address << " closed the stream" << std::endl;
+    m_connected.store(false, std::memory_order_relaxed);
+}
+
+void FlockStreamClient::draw_Gui() const
+{
+    const double bytes_per_boid = m_bytes_per_boid.load(std::memory_order_relaxed);
+    ImGui::Text("Viewing %s%s", m_address.c_str(), m_connected.load(std::memory_order_relaxed) ? "" : " (disconnected)");
+    ImGui::Text("Frames: %llu, keyframes: %llu", static_cast<unsigned long long>(m_frame_count.load(std::memory_order_relaxed)),
+                static_cast<unsigned long long>(m_keyframe_count.load(std::memory_order_relaxed)));
+    ImGui::Text("Last frame: %.2f bytes per boid, %.0f%% of raw floats", bytes_per_boid, 100. * bytes_per_boid / (3 * sizeof(float)));
+}
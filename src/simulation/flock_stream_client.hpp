@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include "flock_snapshot.hpp"
+#include "flock_stream_codec.hpp"
+#include "triple_buffer.hpp"
+
+// Receives the flock stream of a server on its own thread and turns it into snapshots, for `BoidsCube --view`.
+// Takes the place of SimulationThread for the renderer: snapshots come out of a triple buffer the same way.
+class FlockStreamClient {
+public:
+    FlockStreamClient() = default;
+    ~FlockStreamClient();
+    FlockStreamClient(const FlockStreamClient&)            = delete;
+    FlockStreamClient& operator=(const FlockStreamClient&) = delete;
+
+    // See stream_socket.hpp for the address formats. Returns false, after printing why, when the server cannot be reached.
+    bool connect(const std::string& address);
+    void disconnect();
+
+    // Called from the render thread
+    const FlockSnapshot& latest_snapshot();
+    void                 draw_Gui() const;
+
+private:
+    int                         m_socket = -1;
+    std::string                 m_address;
+    std::jthread                m_thread;
+    FlockStreamDecoder          m_decoder;
+    std::vector<std::uint8_t>   m_payload;
+    TripleBuffer<FlockSnapshot> m_snapshots;
+
+    std::atomic<bool>          m_connected{false};
+    std::atomic<std::uint64_t> m_frame_count{0};
+    std::atomic<std::uint64_t> m_keyframe_count{0};
+    std::atomic<double>        m_bytes_per_boid{0.}; // Of the last frame
+
+    void run(std::stop_token stop_token);
+};
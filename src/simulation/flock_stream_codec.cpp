@@ -0,0 +1,170 @@
+#include "flock_stream_codec.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+FlockStreamEncoder::FlockStreamEncoder(float quantum)
+    : m_quantum(quantum), m_inv_quantum(1.f / quantum)
+{
+}
+
+bool FlockStreamEncoder::add_step(std::span<const glm::vec3> positions, std::uint64_t step)
+{
+    const bool same_count = positions.size() == m_current.size();
+    m_step                = step;
+    std::swap(m_before, m_previous);
+    std::swap(m_previous, m_current);
+    m_current.resize(positions.size());
+    for (std::size_t i = 0; i < positions.size(); i++)
+    {
+        const glm::vec3 scaled = positions[i] * m_inv_quantum;
+        m_current[i]           = glm::ivec3(static_cast<int>(std::lround(scaled.x)), static_cast<int>(std::lround(scaled.y)), static_cast<int>(std::lround(scaled.z)));
+    }
+    if (same_count)
+        return true;
+
+    // The keyframe that follows restarts the prediction, boids are not moving as far as it knows
+    m_previous = m_current;
+    m_before   = m_current;
+    return false;
+}
+
+FlockStreamHeader FlockStreamEncoder::make_header(FlockStreamFrameType type, float half_extent, bool unbounded) const
+{
+    FlockStreamHeader header;
+    header.type        = type;
+    header.unbounded   = unbounded ? 1 : 0;
+    header.step        = m_step;
+    header.boid_count  = static_cast<std::uint32_t>(m_current.size());
+    header.quantum     = m_quantum;
+    header.half_extent = half_extent;
+    return header;
+}
+
+// Reserves room for the header at the start of out, it is written once the payload size is known
+static void begin_frame(std::vector<std::uint8_t>& out, std::size_t boid_count, std::size_t bytes_per_boid)
+{
+    out.clear();
+    out.reserve(sizeof(FlockStreamHeader) + boid_count * bytes_per_boid);
+    out.resize(sizeof(FlockStreamHeader));
+}
+
+static void end_frame(std::vector<std::uint8_t>& out, FlockStreamHeader header)
+{
+    header.payload_bytes = static_cast<std::uint32_t>(out.size() - sizeof(FlockStreamHeader));
+    std::memcpy(out.data(), &header, sizeof(header));
+}
+
+void FlockStreamEncoder::write_keyframe(std::span<const Color> colors, float half_extent, bool unbounded, std::vector<std::uint8_t>& out) const
+{
+    begin_frame(out, m_current.size(), 12);
+    for (std::size_t i = 0; i < m_current.size(); i++)
+    {
+        const glm::ivec3 motion = m_current[i] - m_previous[i];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            write_varint(out, m_current[i][axis]);
+        }
+        for (int axis = 0; axis < 3; axis++)
+        {
+            write_varint(out, motion[axis]);
+        }
+    }
+    for (std::size_t i = 0; i < m_current.size(); i++)
+    {
+        const Color color = i < colors.size() ? glm::clamp(colors[i], 0.f, 1.f) : Color(1.f);
+        for (int channel = 0; channel < 3; channel++)
+        {
+            out.push_back(static_cast<std::uint8_t>(std::lround(color[channel] * 255.f)));
+        }
+    }
+    end_frame(out, make_header(FlockStreamFrameType::Keyframe, half_extent, unbounded));
+}
+
+void FlockStreamEncoder::write_delta(float half_extent, bool unbounded, std::vector<std::uint8_t>& out) const
+{
+    begin_frame(out, m_current.size(), 3);
+    for (std::size_t i = 0; i < m_current.size(); i++)
+    {
+        // Predicted at constant speed from the two previous steps
+        const glm::ivec3 residual = m_current[i] - (m_previous[i] + (m_previous[i] - m_before[i]));
+        for (int axis = 0; axis < 3; axis++)
+        {
+            write_varint(out, residual[axis]);
+        }
+    }
+    end_frame(out, make_header(FlockStreamFrameType::Delta, half_extent, unbounded));
+}
+
+static bool read_ivec3(const std::uint8_t*& cursor, const std::uint8_t* end, glm::ivec3& value)
+{
+    return read_varint(cursor, end, value.x) && read_varint(cursor, end, value.y) && read_varint(cursor, end, value.z);
+}
+
+bool FlockStreamDecoder::decode(const FlockStreamHeader& header, std::span<const std::uint8_t> payload, FlockSnapshot& snapshot)
+{
+    const std::uint8_t* cursor = payload.data();
+    const std::uint8_t* end    = payload.data() + payload.size();
+    const std::size_t   count  = header.boid_count;
+
+    // Until the next keyframe, the state is unknown
+    auto fail = [&](const char* reason) {
+        m_has_keyframe = false;
+        std::cerr << "Error: " << reason << " in the flock stream at step " << header.step << std::endl;
+        return false;
+    };
+
+    if (const char* error = flock_stream_header_error(header))
+        return fail(error);
+
+    if (header.type == FlockStreamFrameType::Keyframe)
+    {
+        // Only keyframes change the boid count, the stream does not tell which boids were spawned or despawned
+        if (!m_has_keyframe || count != m_current.size())
+            m_population++;
+        m_current.resize(count);
+        m_motion.resize(count);
+        m_colors.resize(count);
+        for (std::size_t i = 0; i < count; i++)
+        {
+            if (!read_ivec3(cursor, end, m_current[i]) || !read_ivec3(cursor, end, m_motion[i]))
+                return fail("truncated keyframe");
+        }
+        if (static_cast<std::size_t>(end - cursor) < 3 * count)
+            return fail("truncated keyframe colors");
+        for (std::size_t i = 0; i < count; i++)
+        {
+            m_colors[i] = Color(cursor[0], cursor[1], cursor[2]) / 255.f;
+            cursor += 3;
+        }
+        m_has_keyframe = true;
+    }
+    else
+    {
+        if (!m_has_keyframe)
+            return false;
+        if (count != m_current.size())
+            return fail("delta with another boid count than its keyframe");
+        for (std::size_t i = 0; i < count; i++)
+        {
+            glm::ivec3 residual;
+            if (!read_ivec3(cursor, end, residual))
+                return fail("truncated delta");
+            const glm::ivec3 position = m_current[i] + m_motion[i] + residual;
+            m_motion[i]               = position - m_current[i];
+            m_current[i]              = position;
+        }
+    }
+
+    snapshot.positions.resize(count);
+    for (std::size_t i = 0; i < count; i++)
+    {
+        snapshot.positions[i] = glm::vec3(m_current[i]) * header.quantum;
+    }
+    snapshot.colors     = m_colors;
+    snapshot.step       = header.step;
+    snapshot.population = m_population;
+    snapshot.index.build(snapshot.positions, header.half_extent, header.unbounded != 0);
+    return true;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "flock_snapshot.hpp"
+#include "flock_stream_protocol.hpp"
+#include "glm/glm.hpp"
+#include "maths/color.hpp"
+
+// Quantizes the steps of the flock and writes them as keyframes or deltas, see flock_stream_protocol.hpp.
+// Both kinds of frame can be written for the same step, so viewers that need a keyframe and the others are served at once.
+class FlockStreamEncoder {
+public:
+    static constexpr float default_quantum = 1.f / 256.f; // Well under a pixel at the usual camera distances
+
+    explicit FlockStreamEncoder(float quantum = default_quantum);
+
+    // Quantizes the positions of the next step. Returns false when a delta cannot describe it, as the boid count changed.
+    bool add_step(std::span<const glm::vec3> positions, std::uint64_t step);
+
+    // Whole frames, header included, of the last step added. half_extent and unbounded are copied into the header.
+    void write_keyframe(std::span<const Color> colors, float half_extent, bool unbounded, std::vector<std::uint8_t>& out) const;
+    void write_delta(float half_extent, bool unbounded, std::vector<std::uint8_t>& out) const;
+
+private:
+    float         m_quantum;
+    float         m_inv_quantum;
+    std::uint64_t m_step = 0;
+
+    std::vector<glm::ivec3> m_current;  // Quantized positions of the last step
+    std::vector<glm::ivec3> m_previous; // And of the one before, they predict the last step
+    std::vector<glm::ivec3> m_before;
+
+    FlockStreamHeader make_header(FlockStreamFrameType type, float half_extent, bool unbounded) const;
+};
+
+// Rebuilds the snapshots of the flock from the frames of the stream
+class FlockStreamDecoder {
+public:
+    // Fills snapshot with the state after the frame. Returns false, after printing why, when the frame is malformed;
+    // deltas that arrive before the first keyframe are skipped and also return false.
+    bool decode(const FlockStreamHeader& header, std::span<const std::uint8_t> payload, FlockSnapshot& snapshot);
+
+private:
+    bool          m_has_keyframe = false;
+    std::uint64_t m_population   = 0; // See FlockSnapshot::population, changes with the boid count of the keyframes
+
+    std::vector<glm::ivec3> m_current; // Quantized positions, the same as the encoder
+    std::vector<glm::ivec3> m_motion;  // Quantized position minus the one of the previous step
+    std::vector<Color>      m_colors;
+};
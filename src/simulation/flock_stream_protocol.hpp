@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+// Wire format of the flock stream sent by `BoidsCube --serve` to the viewers, see FlockStreamServer.
+// Only standard types are used, so external tools can include this header alone.
+//
+// The stream is a sequence of frames, one per simulation step, each a FlockStreamHeader followed by payload_bytes of
+// payload. Positions are quantized to multiples of quantum and every integer is written as a zigzag LEB128 varint.
+// A keyframe holds, for every boid, its quantized position then its motion (the position minus the one of the previous
+// step), then the colors as 3 bytes each. A delta holds for every boid the difference between its quantized position
+// and the one predicted by the previous frame, position + motion, which is usually a few quanta: about 3 bytes per boid
+// instead of the 12 of raw floats. Both sides predict from quantized values only, so errors never accumulate.
+// Deltas need every frame since the last keyframe: a viewer that lags behind skips frames and resumes at a keyframe.
+//
+// Fields are in the byte order of the host: the server and its viewers are meant to run on the same machine.
+
+enum class FlockStreamFrameType : std::uint8_t {
+    Keyframe = 0,
+    Delta    = 1,
+};
+
+struct FlockStreamHeader {
+    static constexpr std::uint32_t expected_magic   = 0x424F5354; // "BOST"
+    static constexpr std::uint16_t expected_version = 1;
+
+    std::uint32_t        magic         = expected_magic;
+    std::uint16_t        version       = expected_version;
+    FlockStreamFrameType type          = FlockStreamFrameType::Keyframe;
+    std::uint8_t         unbounded     = 0; // The world of the simulation is unbounded
+    std::uint64_t        step          = 0;
+    std::uint32_t        boid_count    = 0;
+    std::uint32_t        payload_bytes = 0;
+    float                quantum       = 0.f; // World units per quantization step
+    float                half_extent   = 0.f; // Of the cube the simulation runs in
+};
+
+static_assert(std::is_trivially_copyable_v<FlockStreamHeader> && sizeof(FlockStreamHeader) == 32, "The header is sent as is");
+
+// Bounds of a frame: varints take 1 to 5 bytes, a keyframe has 6 of them and 3 color bytes per boid, a delta 3 varints
+constexpr std::uint32_t flock_stream_max_boids = 1u << 24;
+constexpr std::uint32_t keyframe_min_bytes     = 6 + 3;
+constexpr std::uint32_t keyframe_max_bytes     = 6 * 5 + 3;
+constexpr std::uint32_t delta_min_bytes        = 3;
+constexpr std::uint32_t delta_max_bytes        = 3 * 5;
+
+// Checks a header received from the wire before anything is allocated for its frame.
+// Returns why it is malformed, or nullptr when it is not.
+inline const char* flock_stream_header_error(const FlockStreamHeader& header)
+{
+    if (header.type != FlockStreamFrameType::Keyframe && header.type != FlockStreamFrameType::Delta)
+        return "unknown frame type";
+    if (header.boid_count > flock_stream_max_boids)
+        return "too many boids";
+
+    const bool          keyframe  = header.type == FlockStreamFrameType::Keyframe;
+    const std::uint64_t min_bytes = std::uint64_t{header.boid_count} * (keyframe ? keyframe_min_bytes : delta_min_bytes);
+    const std::uint64_t max_bytes = std::uint64_t{header.boid_count} * (keyframe ? keyframe_max_bytes : delta_max_bytes);
+    if (header.payload_bytes < min_bytes || header.payload_bytes > max_bytes)
+        return "payload size not matching the boid count";
+    return nullptr;
+}
+
+inline void write_varint(std::vector<std::uint8_t>& out, std::int32_t value)
+{
+    // Zigzag puts small negative values next to small positive ones, then 7 bits per byte, the high bit tells more follow
+    std::uint32_t bits = (static_cast<std::uint32_t>(value) << 1) ^ static_cast<std::uint32_t>(value >> 31);
+    while (bits >= 0x80)
+    {
+        out.push_back(static_cast<std::uint8_t>(bits | 0x80));
+        bits >>= 7;
+    }
+    out.push_back(static_cast<std::uint8_t>(bits));
+}
+
+// Reads one varint at cursor, returns false when the payload ends before it does
+inline bool read_varint(const std::uint8_t*& cursor, const std::uint8_t* end, std::int32_t& value)
+{
+    std::uint32_t bits = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        if (cursor == end)
+            return false;
+        const std::uint8_t byte = *cursor++;
+        bits |= static_cast<std::uint32_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            value = static_cast<std::int32_t>((bits >> 1) ^ (~(bits & 1) + 1));
+            return true;
+        }
+    }
+    return false;
+}
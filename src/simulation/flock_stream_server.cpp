@@ -0,0 +1,122 @@
+#include "flock_stream_server.hpp"
+#include <algorithm>
+#include <iostream>
+#include "profiling/profiler.hpp"
+#include "stream_socket.hpp"
+
+FlockStreamServer::~FlockStreamServer()
+{
+    close();
+}
+
+bool FlockStreamServer::open(const std::string& address)
+{
+    close();
+    m_listener = listen_on(address);
+    if (m_listener < 0)
+        return false;
+
+    m_address = address;
+    std::cout << "Streaming the flock on " << address << std::endl;
+    return true;
+}
+
+void FlockStreamServer::close()
+{
+    for (const Viewer& viewer : m_viewers)
+    {
+        close_socket(viewer.socket);
+    }
+    m_viewers.clear();
+    close_socket(m_listener, m_address);
+    m_listener = -1;
+}
+
+void FlockStreamServer::accept_viewers()
+{
+    for (int socket = accept_from(m_listener); socket >= 0; socket = accept_from(m_listener))
+    {
+        m_viewers.push_back(Viewer{socket, {}, 0, true});
+        std::cout << "Viewer connected, " << m_viewers.size() << " watching" << std::endl;
+    }
+}
+
+bool FlockStreamServer::flush(Viewer& viewer)
+{
+    if (viewer.sent == viewer.pending.size())
+        return true;
+
+    const long sent = send_some(viewer.socket, viewer.pending.data() + viewer.sent, viewer.pending.size() - viewer.sent);
+    if (sent < 0)
+        return false;
+    viewer.sent += static_cast<std::size_t>(sent);
+    return true;
+}
+
+void FlockStreamServer::publish(const Flock& flock)
+{
+    if (m_listener < 0)
+        return;
+    PROFILE_ZONE("Stream export");
+    accept_viewers();
+
+    const BoidPool& boids = flock.get_boids();
+    m_positions.resize(boids.size());
+    for (std::size_t i = 0; i < boids.size(); i++)
+    {
+        m_positions[i] = boids[i].get_position();
+    }
+    // The encoder has to see every step, even without viewers, to predict the next one
+    const bool delta_valid = m_encoder.add_step(m_positions, flock.get_step());
+    if (m_viewers.empty())
+        return;
+
+    const BoidVariables& variables    = flock.get_variables();
+    const bool           all_keyframe = !delta_valid || flock.get_step() % keyframe_interval == 0;
+    const bool           any_keyframe = all_keyframe || std::any_of(m_viewers.begin(), m_viewers.end(), [](const Viewer& viewer) { return viewer.needs_keyframe; });
+    if (any_keyframe)
+    {
+        // Colors only change when boids are spawned, so they are only sent with the keyframes
+        m_colors.resize(boids.size());
+        for (std::size_t i = 0; i < boids.size(); i++)
+        {
+            m_colors[i] = boids[i].get_color();
+        }
+        m_encoder.write_keyframe(m_colors, variables.cube_length, variables.unbounded_world, m_keyframe);
+        m_keyframe_bytes += m_keyframe.size();
+        m_keyframe_boids += boids.size();
+    }
+    if (!all_keyframe)
+    {
+        m_encoder.write_delta(variables.cube_length, variables.unbounded_world, m_delta);
+        m_delta_bytes += m_delta.size();
+        m_delta_boids += boids.size();
+    }
+
+    for (auto viewer = m_viewers.begin(); viewer != m_viewers.end();)
+    {
+        bool connected = flush(*viewer);
+        if (connected && viewer->sent < viewer->pending.size())
+        {
+            // Still sending an older frame: this step is skipped, so the next one must be a keyframe
+            viewer->needs_keyframe = true;
+        }
+        else if (connected)
+        {
+            const bool keyframe    = all_keyframe || viewer->needs_keyframe;
+            viewer->pending        = keyframe ? m_keyframe : m_delta;
+            viewer->sent           = 0;
+            viewer->needs_keyframe = false;
+            connected              = flush(*viewer);
+        }
+
+        if (connected)
+        {
+            ++viewer;
+            continue;
+        }
+        close_socket(viewer->socket);
+        viewer = m_viewers.erase(viewer);
+        std::cout << "Viewer disconnected, " << m_viewers.size() << " watching" << std::endl;
+    }
+}
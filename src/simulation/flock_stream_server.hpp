@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "flock.hpp"
+#include "flock_stream_codec.hpp"
+
+// Streams every step of the flock to the viewers connected to a socket, see flock_stream_protocol.hpp.
+// Each step is encoded once and the same bytes go to every viewer. Sockets never block the simulation: a viewer that
+// cannot keep up skips steps, then resumes at a keyframe sent to it alone.
+class FlockStreamServer {
+public:
+    static constexpr std::uint64_t keyframe_interval = 120; // Steps between the keyframes sent to every viewer
+
+    FlockStreamServer() = default;
+    ~FlockStreamServer();
+    FlockStreamServer(const FlockStreamServer&)            = delete;
+    FlockStreamServer& operator=(const FlockStreamServer&) = delete;
+
+    // See stream_socket.hpp for the address formats. Returns false, after printing why, when the socket cannot be opened.
+    bool open(const std::string& address);
+    void close();
+
+    bool is_open() const { return m_listener >= 0; }
+
+    // Called by the simulation once a step is complete, never blocks
+    void publish(const Flock& flock);
+
+    // Bytes sent per boid, averaged over the deltas then over the keyframes, for the bandwidth report
+    double mean_delta_bytes_per_boid() const { return m_delta_boids > 0 ? static_cast<double>(m_delta_bytes) / static_cast<double>(m_delta_boids) : 0.; }
+    double mean_keyframe_bytes_per_boid() const { return m_keyframe_boids > 0 ? static_cast<double>(m_keyframe_bytes) / static_cast<double>(m_keyframe_boids) : 0.; }
+
+private:
+    struct Viewer {
+        int                       socket;
+        std::vector<std::uint8_t> pending; // Frame being sent
+        std::size_t               sent           = 0;
+        bool                      needs_keyframe = true;
+    };
+
+    std::string         m_address;
+    int                 m_listener = -1;
+    std::vector<Viewer> m_viewers;
+
+    FlockStreamEncoder        m_encoder;
+    std::vector<glm::vec3>    m_positions; // Copied out of the boid pool for the encoder
+    std::vector<Color>        m_colors;
+    std::vector<std::uint8_t> m_keyframe;
+    std::vector<std::uint8_t> m_delta;
+
+    std::uint64_t m_delta_bytes    = 0;
+    std::uint64_t m_delta_boids    = 0;
+    std::uint64_t m_keyframe_bytes = 0;
+    std::uint64_t m_keyframe_boids = 0;
+
+    void accept_viewers();
+
+    // Sends what the socket takes of the pending frame, returns false when the viewer is gone
+    static bool flush(Viewer& viewer);
+};
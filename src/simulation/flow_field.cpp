@@ -0,0 +1,143 @@
+#include "flow_field.hpp"
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <queue>
+#include "glm/gtx/norm.hpp"
+#include "profiling/profiler.hpp"
+
+// The 26 neighbors of a cell
+static std::vector<glm::ivec3> neighbor_offsets()
+{
+    std::vector<glm::ivec3> offsets;
+    for (int z = -1; z <= 1; z++)
+        for (int y = -1; y <= 1; y++)
+            for (int x = -1; x <= 1; x++)
+                if (x != 0 || y != 0 || z != 0)
+                    offsets.emplace_back(x, y, z);
+    return offsets;
+}
+
+static bool is_inside(const glm::ivec3& cell)
+{
+    return glm::all(glm::greaterThanEqual(cell, glm::ivec3(0))) && glm::all(glm::lessThan(cell, glm::ivec3(FlowField::resolution)));
+}
+
+bool FlowField::update(const FlowTargets& targets, float half_extent)
+{
+    const bool same_grid = half_extent == m_half_extent && !m_directions.empty();
+    m_half_extent        = half_extent;
+    m_cell_size          = 2.f * half_extent / static_cast<float>(resolution);
+    m_inv_cell_size      = 1.f / m_cell_size;
+
+    const glm::ivec3 goal_cell = cell_of(targets.goal);
+    if (same_grid && goal_cell == m_goal_cell && targets.obstacles == m_obstacles)
+        return false;
+
+    m_goal_cell = goal_cell;
+    m_obstacles = targets.obstacles;
+    build(targets);
+    return true;
+}
+
+void FlowField::build(const FlowTargets& targets)
+{
+    PROFILE_ZONE("Flow field");
+    const auto start_time = std::chrono::steady_clock::now();
+
+    const std::size_t cell_count = static_cast<std::size_t>(resolution) * resolution * resolution;
+    constexpr float   unreached  = std::numeric_limits<float>::infinity();
+    m_distances.assign(cell_count, unreached);
+    m_blocked.assign(cell_count, 0);
+    m_directions.assign(cell_count, glm::vec3{0.f});
+
+    using Entry = std::pair<float, std::uint32_t>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<>> queue;
+
+    for (int z = 0; z < resolution; z++)
+    {
+        for (int y = 0; y < resolution; y++)
+        {
+            for (int x = 0; x < resolution; x++)
+            {
+                const glm::ivec3  cell   = {x, y, z};
+                const glm::vec3   center = center_of(cell);
+                const std::size_t index  = cell_index(cell);
+                for (const FlowObstacle& obstacle : targets.obstacles)
+                {
+                    const glm::vec3 away = center - obstacle.center;
+                    if (glm::length2(away) < (obstacle.radius + clearance) * (obstacle.radius + clearance))
+                    {
+                        // Boids that end up inside are pushed out the shortest way
+                        m_blocked[index]    = 1;
+                        m_directions[index] = glm::length2(away) > 0.f ? glm::normalize(away) : glm::vec3{0.f, 1.f, 0.f};
+                        break;
+                    }
+                }
+
+                // Every free cell around the goal is a source, so the goal itself may sit in an obstacle
+                if (m_blocked[index] == 0 && (cell == m_goal_cell || glm::distance2(center, targets.goal) < goal_radius * goal_radius))
+                {
+                    m_distances[index] = 0.f;
+                    queue.emplace(0.f, static_cast<std::uint32_t>(index));
+                }
+            }
+        }
+    }
+
+    static const std::vector<glm::ivec3> offsets = neighbor_offsets();
+    while (!queue.empty())
+    {
+        const auto [distance, index] = queue.top();
+        queue.pop();
+        if (distance > m_distances[index])
+            continue;
+
+        const glm::ivec3 cell = {static_cast<int>(index) % resolution, static_cast<int>(index) / resolution % resolution, static_cast<int>(index) / (resolution * resolution)};
+        for (const glm::ivec3& offset : offsets)
+        {
+            const glm::ivec3 next = cell + offset;
+            if (!is_inside(next))
+                continue;
+
+            const std::size_t next_index = cell_index(next);
+            const float       next_cost  = distance + glm::length(glm::vec3(offset));
+            if (m_blocked[next_index] == 0 && next_cost < m_distances[next_index])
+            {
+                m_distances[next_index] = next_cost;
+                queue.emplace(next_cost, static_cast<std::uint32_t>(next_index));
+            }
+        }
+    }
+
+    // Each reached cell points to its neighbor closest to the goal
+    for (int z = 0; z < resolution; z++)
+    {
+        for (int y = 0; y < resolution; y++)
+        {
+            for (int x = 0; x < resolution; x++)
+            {
+                const glm::ivec3  cell  = {x, y, z};
+                const std::size_t index = cell_index(cell);
+                if (m_blocked[index] != 0 || m_distances[index] == 0.f || m_distances[index] == unreached)
+                    continue;
+
+                float      best_distance = m_distances[index];
+                glm::ivec3 best_offset{0};
+                for (const glm::ivec3& offset : offsets)
+                {
+                    const glm::ivec3 next = cell + offset;
+                    if (is_inside(next) && m_distances[cell_index(next)] < best_distance)
+                    {
+                        best_distance = m_distances[cell_index(next)];
+                        best_offset   = offset;
+                    }
+                }
+                m_directions[index] = glm::normalize(glm::vec3(best_offset));
+            }
+        }
+    }
+
+    m_build_count++;
+    m_build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "glm/glm.hpp"
+
+// Spheres the flow routes around, such as the planets
+struct FlowObstacle {
+    glm::vec3 center;
+    float     radius = 0.f;
+
+    bool operator==(const FlowObstacle&) const = default;
+};
+
+// Where the flow leads and what it avoids, sent by the render thread every frame
+struct FlowTargets {
+    glm::vec3                 goal{0.f};
+    std::vector<FlowObstacle> obstacles;
+};
+
+// Direction toward the goal around the obstacles for every cell of a grid over the cube, so boids steer in O(1).
+// The field comes from a multi-source Dijkstra pass out of the cells around the goal, and is only computed again when
+// the goal moves to another cell or the obstacles change.
+class FlowField {
+public:
+    static constexpr int   resolution  = 24;
+    static constexpr float goal_radius = 1.f;  // Cells closer than this to the goal are all sources
+    static constexpr float clearance   = 0.3f; // Margin kept around the obstacles
+
+    // Returns true when the field was computed again
+    bool update(const FlowTargets& targets, float half_extent);
+
+    // Unit direction to follow at position, zero at the goal and where it cannot be reached.
+    // Inside an obstacle, points out of it. Positions outside the cube use the closest cell.
+    glm::vec3 sample(const glm::vec3& position) const
+    {
+        if (m_directions.empty())
+            return glm::vec3{0.f};
+        return m_directions[cell_index(cell_of(position))];
+    }
+
+    std::uint64_t get_build_count() const { return m_build_count; }
+    double        get_build_ms() const { return m_build_ms; }
+
+private:
+    float m_half_extent   = 0.f;
+    float m_cell_size     = 1.f;
+    float m_inv_cell_size = 1.f;
+
+    glm::ivec3                m_goal_cell{-1};
+    std::vector<FlowObstacle> m_obstacles;
+    std::vector<glm::vec3>    m_directions;
+    std::vector<float>        m_distances; // Kept between builds so they do not allocate
+    std::vector<std::uint8_t> m_blocked;
+
+    std::uint64_t m_build_count = 0;
+    double        m_build_ms    = 0.;
+
+    glm::ivec3 cell_of(const glm::vec3& position) const
+    {
+        const glm::ivec3 cell(glm::floor((position + m_half_extent) * m_inv_cell_size));
+        return glm::clamp(cell, glm::ivec3(0), glm::ivec3(resolution - 1));
+    }
+    glm::vec3 center_of(const glm::ivec3& cell) const { return (glm::vec3(cell) + 0.5f) * m_cell_size - m_half_extent; }
+
+    static std::size_t cell_index(const glm::ivec3& cell) { return static_cast<std::size_t>((cell.z * resolution + cell.y) * resolution + cell.x); }
+
+    void build(const FlowTargets& targets);
+};
@@ -0,0 +1,125 @@
+#include "headless_runner.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "flock.hpp"
+#include "flock_stream_server.hpp"
+#include "numa.hpp"
+#include "shared_flock_export.hpp"
+
+static void print_header()
+{
+    std::cout << "step,step_ms,polarization,mean_neighbors,capped,occupied_cells,max_cell_occupancy";
+    for (std::size_t bin = 0; bin < FlockStatistics::histogram_bins; bin++)
+    {
+        std::cout << ",neighbors_bin_" << bin;
+    }
+    std::cout << '\n';
+}
+
+// Compares the placement of the flock arrays with what a single thread touching them first would have given
+static void print_numa_report(const Flock& flock)
+{
+    const WorkerPool& workers = flock.get_workers();
+    std::cout << "# NUMA nodes: " << NumaTopology::get().get_node_count() << ", workers: " << workers.get_worker_count()
+              << ", transparent huge pages: " << transparent_huge_pages_mode() << ", huge pages requested: " << flock.get_variables().huge_pages << '\n';
+
+    const NumaLocality placed = flock.measure_locality();
+    if (!placed.is_available)
+    {
+        std::cout << "# page locality: unavailable on this platform\n";
+        return;
+    }
+
+    std::vector<glm::vec3> serial_touch(flock.get_boids().size(), glm::vec3{0.f});
+    const NumaLocality     baseline = measure_locality(serial_touch.data(), serial_touch.size(), sizeof(glm::vec3), workers);
+    std::cout << "# pages on the node of their worker: " << 100.f * placed.local_ratio() << "% of " << placed.total_pages << " with first touch, "
+              << 100.f * baseline.local_ratio() << "% of " << baseline.total_pages << " when touched by one thread\n"
+              << "# remote page accesses: " << 100.f * (1.f - placed.local_ratio()) << "% instead of " << 100.f * (1.f - baseline.local_ratio()) << "%\n";
+}
+
+// Error of neighbor sampling against the exact steering of the final flock, for growing sample sizes
+static void print_sampling_report(Flock& flock)
+{
+    std::cout << "# sample_size,relative_error,exact_ms,sampled_ms\n";
+    for (int sample_size : {4, 8, 16, 32, 64, 128})
+    {
+        const SamplingError error = flock.measure_sampling_error(sample_size);
+        std::cout << "# " << error.sample_size << ',' << error.relative_error << ',' << error.exact_ms << ',' << error.sampled_ms << '\n';
+    }
+}
+
+// The portable kernel is the reference the copies for wider instruction sets are compared to
+static void print_isa_report(Flock& flock)
+{
+    std::cout << "# isa,step_ms,max_velocity_difference\n";
+    for (const IsaKernelTiming& timing : flock.measure_isa_kernels())
+    {
+        std::cout << "# " << isa_name(timing.isa) << ',' << timing.step_ms << ',' << timing.max_difference << '\n';
+    }
+}
+
+static void print_stream_report(const FlockStreamServer& server)
+{
+    constexpr double raw_bytes = 3 * sizeof(float);
+    std::cout << "# stream bytes per boid: " << server.mean_delta_bytes_per_boid() << " in deltas, " << server.mean_keyframe_bytes_per_boid() << " in keyframes, "
+              << raw_bytes << " as raw floats\n";
+}
+
+static void print_row(std::uint64_t step, double step_ms, const FlockStatistics& statistics)
+{
+    std::cout << step << ',' << step_ms << ',' << statistics.polarization() << ',' << statistics.mean_neighbor_count() << ','
+              << statistics.capped_count << ',' << statistics.occupied_cells << ',' << statistics.max_cell_occupancy;
+    for (std::uint32_t count : statistics.neighbor_histogram)
+    {
+        std::cout << ',' << count;
+    }
+    std::cout << '\n';
+}
+
+int run_headless(const HeadlessOptions& options, const BoidVariables& variables)
+{
+    // Nothing else runs on this thread, it steps the flock as worker 0
+    Flock flock(options.boid_count);
+    flock.get_workers().pin_caller();
+    flock.set_variables(variables);
+
+    SharedFlockExport shared_export;
+    if (!options.shared_memory_name.empty() && !shared_export.open(options.shared_memory_name, options.boid_count))
+        return 1;
+    FlockStreamServer stream_server;
+    if (!options.stream_address.empty() && !stream_server.open(options.stream_address))
+        return 1;
+
+    print_header();
+    auto next_step = std::chrono::steady_clock::now();
+    for (std::uint64_t step = 1; step <= options.steps; step++)
+    {
+        const auto start_time = std::chrono::steady_clock::now();
+        flock.update();
+        const auto end_time = std::chrono::steady_clock::now();
+        shared_export.publish(flock);
+        stream_server.publish(flock);
+
+        if (options.report_every > 0 && step % options.report_every == 0)
+        {
+            print_row(step, std::chrono::duration<double, std::milli>(end_time - start_time).count(), flock.get_statistics());
+            if (stream_server.is_open())
+                print_stream_report(stream_server);
+        }
+        if (stream_server.is_open())
+        {
+            // Same schedule as SimulationThread::run, without catch-up bursts after a stall
+            next_step += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1. / flock.get_variables().steps_per_second));
+            next_step = std::max(next_step, std::chrono::steady_clock::now());
+            std::this_thread::sleep_until(next_step);
+        }
+    }
+    print_numa_report(flock);
+    print_sampling_report(flock);
+    print_isa_report(flock);
+    std::cout.flush();
+    return 0;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "scene_objects/boid.hpp"
+
+struct HeadlessOptions {
+    std::size_t   boid_count   = 80;
+    std::uint64_t steps        = 600;
+    std::uint64_t report_every = 60;
+    std::string   shared_memory_name; // Publishes every step to this POSIX shared memory when not empty
+    std::string   stream_address;     // Streams every step to the viewers of this socket when not empty, see FlockStreamServer
+};
+
+// Steps the flock without opening a window and prints its statistics as CSV every report_every steps.
+// While streaming, steps are paced at BoidVariables::steps_per_second so that viewers see the flock in real time.
+int run_headless(const HeadlessOptions& options, const BoidVariables& variables);
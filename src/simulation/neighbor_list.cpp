@@ -0,0 +1,108 @@
+#include "neighbor_list.hpp"
+#include <algorithm>
+#include "glm/gtx/norm.hpp"
+
+void NeighborList::build(std::span<const glm::vec3> positions, const SpatialGrid& grid, float radius, float skin, WorkerPool& workers)
+{
+    build_from(positions, grid, radius, skin, workers);
+}
+
+void NeighborList::build(std::span<const glm::vec3> positions, const SparseGrid& grid, float radius, float skin, WorkerPool& workers)
+{
+    build_from(positions, grid, radius, skin, workers);
+}
+
+template<typename Grid>
+void NeighborList::build_from(std::span<const glm::vec3> positions, const Grid& grid, float radius, float skin, WorkerPool& workers)
+{
+    const std::size_t boid_count    = positions.size();
+    const float       search_radius = radius + skin;
+
+    m_radius = radius;
+    m_skin   = skin;
+    m_reference_positions.assign(positions.begin(), positions.end());
+    m_roaming_flags.assign(boid_count, 0);
+    m_roaming.clear();
+    m_worker_buffers.resize(workers.get_worker_count());
+    for (WorkerBuffer& buffer : m_worker_buffers)
+    {
+        // clear() keeps the capacity, so steady-state rebuilds do not allocate
+        buffer.counts.clear();
+        buffer.neighbors.clear();
+    }
+
+    workers.parallel_for(boid_count, [&](std::size_t begin, std::size_t end, std::size_t worker) {
+        WorkerBuffer& buffer = m_worker_buffers[worker];
+        buffer.first_boid    = begin;
+        for (std::size_t i = begin; i < end; i++)
+        {
+            const std::size_t first_neighbor = buffer.neighbors.size();
+            grid.visit_near_to_far(positions[i], [&](std::uint32_t index) {
+                if (glm::distance2(positions[i], positions[index]) < search_radius * search_radius)
+                    buffer.neighbors.push_back(index);
+                return true;
+            });
+            buffer.counts.push_back(static_cast<std::uint32_t>(buffer.neighbors.size() - first_neighbor));
+        }
+    });
+
+    // Slices are contiguous and in worker order, so a prefix sum over the buffers gives the final layout
+    m_offsets.resize(boid_count + 1);
+    std::uint32_t offset = 0;
+    for (WorkerBuffer& buffer : m_worker_buffers)
+    {
+        buffer.output_offset = offset;
+        for (std::size_t k = 0; k < buffer.counts.size(); k++)
+        {
+            m_offsets[buffer.first_boid + k] = offset;
+            offset += buffer.counts[k];
+        }
+    }
+    m_offsets[boid_count] = offset;
+    m_neighbors.resize(offset);
+
+    // Same loop size, so every worker gets the same slice again and copies the buffer it filled
+    workers.parallel_for(boid_count, [&](std::size_t /*begin*/, std::size_t /*end*/, std::size_t worker) {
+        const WorkerBuffer& buffer = m_worker_buffers[worker];
+        std::copy(buffer.neighbors.begin(), buffer.neighbors.end(), m_neighbors.begin() + buffer.output_offset);
+    });
+}
+
+void NeighborList::set_placement(const NumaPlacement& placement)
+{
+    m_offsets   = NumaVector<std::uint32_t>(NumaAllocator<std::uint32_t>(placement));
+    m_neighbors = NumaVector<std::uint32_t>(NumaAllocator<std::uint32_t>(placement));
+    m_radius    = -1.f;
+}
+
+NumaLocality NeighborList::measure_locality(const WorkerPool& workers) const
+{
+    // Candidates are not split like boids, only the offsets can be checked against their owners
+    return ::measure_locality(m_offsets.data(), m_offsets.size(), sizeof(std::uint32_t), workers);
+}
+
+bool NeighborList::update(std::span<const glm::vec3> positions, float radius, float skin, WorkerPool& workers)
+{
+    if (radius != m_radius || skin != m_skin || positions.size() != m_reference_positions.size())
+        return true;
+
+    const float max_displacement2 = 0.25f * skin * skin;
+    workers.parallel_for(positions.size(), [&](std::size_t begin, std::size_t end, std::size_t /*worker*/) {
+        for (std::size_t i = begin; i < end; i++)
+        {
+            m_roaming_flags[i] = glm::distance2(positions[i], m_reference_positions[i]) > max_displacement2;
+        }
+    });
+
+    m_roaming.clear();
+    for (std::size_t i = 0; i < positions.size(); i++)
+    {
+        if (m_roaming_flags[i] != 0)
+        {
+            if (m_roaming.size() == max_roaming)
+                return true;
+            m_roaming.push_back(static_cast<std::uint32_t>(i));
+        }
+    }
+    return false;
+}
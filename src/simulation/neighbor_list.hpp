@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "glm/glm.hpp"
+#include "numa.hpp"
+#include "sparse_grid.hpp"
+#include "spatial_grid.hpp"
+#include "worker_pool.hpp"
+
+// Verlet lists: the candidates within radius + skin of every boid, kept for as long as no boid moved more than skin / 2.
+// Until then, every boid closer than radius is guaranteed to be in the list, so steps can skip the grid altogether.
+// Boids that moved further, typically because they wrapped around the cube, are "roaming": they are searched through
+// the grid of the last build and checked by everyone, which saves a full rebuild each time a single boid wraps.
+class NeighborList {
+public:
+    static constexpr std::size_t max_roaming = 32;
+
+    // Where the offsets and candidates go, drops the current list
+    void set_placement(const NumaPlacement& placement);
+
+    // grid must have been built with a radius of at least radius + skin, and be kept until the next build
+    void build(std::span<const glm::vec3> positions, const SpatialGrid& grid, float radius, float skin, WorkerPool& workers);
+    void build(std::span<const glm::vec3> positions, const SparseGrid& grid, float radius, float skin, WorkerPool& workers);
+
+    // Finds the roaming boids, returns true when the list has to be rebuilt before the next step
+    bool update(std::span<const glm::vec3> positions, float radius, float skin, WorkerPool& workers);
+
+    bool                           is_roaming(std::size_t index) const { return m_roaming_flags[index] != 0; }
+    std::span<const std::uint32_t> get_roaming() const { return m_roaming; }
+
+    // Candidates of a boid, itself included, in the near-to-far cell order of the grid
+    std::span<const std::uint32_t> neighbors_of(std::size_t index) const
+    {
+        return {m_neighbors.data() + m_offsets[index], m_neighbors.data() + m_offsets[index + 1]};
+    }
+
+    std::size_t get_entry_count() const { return m_neighbors.size(); }
+
+    // Share of the offsets of each boid on the node of the worker that owns it, see ::measure_locality
+    NumaLocality measure_locality(const WorkerPool& workers) const;
+
+private:
+    // Each worker fills its own buffer for its slice of boids, they are then concatenated in slice order
+    struct alignas(64) WorkerBuffer {
+        std::size_t                first_boid = 0;
+        std::vector<std::uint32_t> counts;
+        std::vector<std::uint32_t> neighbors;
+        std::size_t                output_offset = 0;
+    };
+
+    float m_radius = -1.f;
+    float m_skin   = 0.f;
+
+    std::vector<glm::vec3>     m_reference_positions; // Positions at the last build
+    NumaVector<std::uint32_t>  m_offsets;             // Start of the candidates of each boid, plus a final end offset
+    NumaVector<std::uint32_t>  m_neighbors;
+    std::vector<WorkerBuffer>  m_worker_buffers;
+    std::vector<std::uint8_t>  m_roaming_flags;
+    std::vector<std::uint32_t> m_roaming;
+
+    template<typename Grid>
+    void build_from(std::span<const glm::vec3> positions, const Grid& grid, float radius, float skin, WorkerPool& workers);
+};
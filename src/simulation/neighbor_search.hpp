@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include "glm/glm.hpp"
+#include "neighbor_list.hpp"
+#include "sparse_grid.hpp"
+#include "spatial_grid.hpp"
+
+// Where the step kernels get the neighbor candidates of a boid from, nearest cells first.
+// The source is picked once per step, so the kernels stay the same whatever the acceleration structure.
+struct NeighborSearch {
+    const SpatialGrid*  grid        = nullptr;
+    const SparseGrid*   sparse_grid = nullptr; // Used instead of grid in an unbounded world
+    const NeighborList* list        = nullptr; // Used instead of the grids when set
+
+    // Neighbor sampling, see Boid::steer_with_rules
+    float         sample_size   = 0.f; // Expected number of sampled candidates per boid
+    std::uint64_t sampling_seed = 0;   // Changes every step so boids do not keep the same sample
+
+    template<typename Visitor>
+    void visit_cells(const glm::vec3& position, Visitor&& visitor) const
+    {
+        if (sparse_grid != nullptr)
+            sparse_grid->visit_near_to_far(position, visitor);
+        else
+            grid->visit_near_to_far(position, visitor);
+    }
+
+    // Number of candidates visit() would go through, roaming boids counted once
+    std::size_t count_candidates(std::size_t index, const glm::vec3& position) const
+    {
+        if (list == nullptr)
+            return sparse_grid != nullptr ? sparse_grid->count_near(position) : grid->count_near(position);
+
+        const std::size_t own = list->is_roaming(index)
+                                    ? (sparse_grid != nullptr ? sparse_grid->count_near(position) : grid->count_near(position))
+                                    : list->neighbors_of(index).size();
+        return own + list->get_roaming().size();
+    }
+
+    // visitor(index) returns false to stop the search
+    template<typename Visitor>
+    void visit(std::size_t index, const glm::vec3& position, Visitor&& visitor) const
+    {
+        if (list == nullptr)
+        {
+            visit_cells(position, visitor);
+            return;
+        }
+
+        // Roaming boids are skipped where they used to be and visited once from the roaming set
+        bool stopped      = false;
+        auto settled_only = [&](std::uint32_t candidate) {
+            if (list->is_roaming(candidate))
+                return true;
+            stopped = !visitor(candidate);
+            return !stopped;
+        };
+
+        if (list->is_roaming(index))
+        {
+            // The grid of the last build still holds every settled boid within radius + skin / 2 of its cell
+            visit_cells(position, settled_only);
+        }
+        else
+        {
+            for (std::uint32_t candidate : list->neighbors_of(index))
+            {
+                if (!settled_only(candidate))
+                    break;
+            }
+        }
+
+        if (stopped)
+            return;
+        for (std::uint32_t candidate : list->get_roaming())
+        {
+            if (!visitor(candidate))
+                return;
+        }
+    }
+};
@@ -0,0 +1,278 @@
+#include "numa.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <utility>
+#include "worker_pool.hpp"
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Parses sysfs CPU lists such as "0-3,8-11"
+static std::vector<int> parse_cpu_list(const std::string& list)
+{
+    std::vector<int>  cpus;
+    std::stringstream stream(list);
+    std::string       range;
+    while (std::getline(stream, range, ','))
+    {
+        const std::size_t dash = range.find('-');
+        try
+        {
+            const int first = std::stoi(range.substr(0, dash));
+            const int last  = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; cpu++)
+                cpus.push_back(cpu);
+        }
+        catch (const std::exception&)
+        {
+            // Empty lists are written as a lone newline
+        }
+    }
+    return cpus;
+}
+
+NumaTopology::NumaTopology()
+{
+    std::vector<std::pair<int, std::vector<int>>> nodes;
+#ifdef __linux__
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator("/sys/devices/system/node", error))
+    {
+        const std::string name = entry.path().filename().string();
+        if (name.size() <= 4 || name.rfind("node", 0) != 0 || !std::isdigit(static_cast<unsigned char>(name[4])))
+            continue;
+
+        std::ifstream file(entry.path() / "cpulist");
+        std::string   list;
+        std::getline(file, list);
+        std::vector<int> cpus = parse_cpu_list(list);
+        if (!cpus.empty())
+            nodes.emplace_back(std::stoi(name.substr(4)), std::move(cpus));
+    }
+#endif
+    if (nodes.empty())
+        nodes.emplace_back(0, std::vector<int>{});
+
+    // directory_iterator has no order
+    std::sort(nodes.begin(), nodes.end());
+    for (auto& [id, cpus] : nodes)
+    {
+        m_node_ids.push_back(id);
+        m_node_cpus.push_back(std::move(cpus));
+    }
+}
+
+const NumaTopology& NumaTopology::get()
+{
+    static const NumaTopology topology;
+    return topology;
+}
+
+int NumaTopology::node_of_worker(std::size_t worker, std::size_t worker_count) const
+{
+    std::size_t cpu_count = 0;
+    for (const auto& cpus : m_node_cpus)
+        cpu_count += cpus.size();
+    if (m_node_cpus.size() == 1 || cpu_count == 0)
+        return m_node_ids.front();
+
+    // Position of the worker among all the CPUs, then the node holding that CPU
+    std::size_t cpu = worker * cpu_count / std::max<std::size_t>(worker_count, 1);
+    for (std::size_t node = 0; node < m_node_cpus.size(); node++)
+    {
+        if (cpu < m_node_cpus[node].size())
+            return m_node_ids[node];
+        cpu -= m_node_cpus[node].size();
+    }
+    return m_node_ids.back();
+}
+
+void NumaTopology::pin_current_thread(int node) const
+{
+#ifdef __linux__
+    if (m_node_cpus.size() < 2)
+        return;
+
+    const auto index = static_cast<std::size_t>(std::find(m_node_ids.begin(), m_node_ids.end(), node) - m_node_ids.begin());
+    if (index == m_node_ids.size())
+        return;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : m_node_cpus[index])
+        CPU_SET(cpu, &set);
+    sched_setaffinity(0, sizeof(set), &set);
+#else
+    (void)node;
+#endif
+}
+
+static std::size_t round_up(std::size_t value, std::size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static std::size_t page_bytes()
+{
+#ifdef __linux__
+    static const std::size_t bytes = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    return bytes;
+#else
+    return 4096;
+#endif
+}
+
+static std::size_t mapping_alignment(const NumaPlacement& placement)
+{
+    return placement.huge_pages ? NumaPlacement::huge_page_bytes : page_bytes();
+}
+
+// Each worker writes the slice of elements it will own in parallel_for, so the kernel places those pages on its node
+static void first_touch(void* memory, std::size_t bytes, std::size_t element_size, WorkerPool* workers)
+{
+    auto*             data  = static_cast<std::byte*>(memory);
+    const std::size_t count = bytes / element_size;
+    auto              touch = [&](std::size_t begin, std::size_t end, std::size_t /*worker*/) {
+        std::memset(data + begin * element_size, 0, (end - begin) * element_size);
+    };
+    if (workers != nullptr)
+        workers->parallel_for(count, touch);
+    else
+        touch(0, count, 0);
+}
+
+void* allocate_untouched(std::size_t bytes, const NumaPlacement& placement)
+{
+    if (bytes < NumaPlacement::large_array_bytes)
+        return ::operator new(bytes, std::align_val_t{64});
+
+#ifdef __linux__
+    // Huge pages need a 2 MiB aligned region, which mmap only gives by mapping more and trimming
+    const std::size_t alignment = mapping_alignment(placement);
+    const std::size_t size      = round_up(bytes, alignment);
+    const std::size_t extra     = alignment > page_bytes() ? alignment : 0;
+    void*             mapping   = mmap(nullptr, size + extra, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED)
+        throw std::bad_alloc();
+
+    auto*             start   = static_cast<std::byte*>(mapping);
+    auto*             aligned = reinterpret_cast<std::byte*>(round_up(reinterpret_cast<std::uintptr_t>(start), alignment));
+    const std::size_t head    = static_cast<std::size_t>(aligned - start);
+    if (head > 0)
+        munmap(start, head);
+    if (extra - head > 0)
+        munmap(aligned + size, extra - head);
+
+    if (placement.huge_pages)
+        madvise(aligned, size, MADV_HUGEPAGE);
+    return aligned;
+#else
+    return ::operator new(bytes, std::align_val_t{64});
+#endif
+}
+
+void* allocate_placed(std::size_t bytes, std::size_t element_size, const NumaPlacement& placement)
+{
+    void* memory = allocate_untouched(bytes, placement);
+    if (bytes >= NumaPlacement::large_array_bytes)
+        first_touch(memory, bytes, element_size, placement.workers);
+    return memory;
+}
+
+void deallocate_placed(void* memory, std::size_t bytes, const NumaPlacement& placement)
+{
+    if (bytes < NumaPlacement::large_array_bytes)
+    {
+        ::operator delete(memory, std::align_val_t{64});
+        return;
+    }
+
+#ifdef __linux__
+    munmap(memory, round_up(bytes, mapping_alignment(placement)));
+#else
+    (void)placement;
+    ::operator delete(memory, std::align_val_t{64});
+#endif
+}
+
+void NumaLocality::merge(const NumaLocality& other)
+{
+    local_pages += other.local_pages;
+    total_pages += other.total_pages;
+    is_available = is_available || other.is_available;
+}
+
+NumaLocality measure_locality(const void* data, std::size_t count, std::size_t element_size, const WorkerPool& workers)
+{
+    return measure_locality(data, 0, count, count, element_size, workers);
+}
+
+NumaLocality measure_locality(const void* data, std::size_t first, std::size_t count, std::size_t total_count, std::size_t element_size, const WorkerPool& workers)
+{
+    NumaLocality locality;
+#ifdef __linux__
+    const NumaTopology& topology     = NumaTopology::get();
+    const std::size_t   worker_count = workers.get_worker_count();
+    const auto          base         = reinterpret_cast<std::uintptr_t>(data);
+    for (std::size_t worker = 0; worker < worker_count; worker++)
+    {
+        // Pages starting inside the part of the slice of the worker held by data, with the same split as parallel_for
+        const std::size_t slice_begin = std::clamp(total_count * worker / worker_count, first, first + count) - first;
+        const std::size_t slice_end   = std::clamp(total_count * (worker + 1) / worker_count, first, first + count) - first;
+        if (slice_begin == slice_end)
+            continue;
+        const std::uintptr_t begin = round_up(base + slice_begin * element_size, page_bytes());
+        const std::uintptr_t end   = base + slice_end * element_size;
+
+        std::vector<void*> pages;
+        for (std::uintptr_t page = begin; page < end; page += page_bytes())
+            pages.push_back(reinterpret_cast<void*>(page));
+        if (pages.empty())
+            continue;
+
+        // With no target nodes, move_pages only reports where each page is
+        std::vector<int> status(pages.size(), -1);
+        if (syscall(SYS_move_pages, 0, pages.size(), pages.data(), nullptr, status.data(), 0) != 0)
+            return {};
+
+        const int node = topology.node_of_worker(worker, worker_count);
+        for (int page_node : status)
+        {
+            if (page_node < 0)
+                continue;
+            locality.total_pages++;
+            locality.local_pages += page_node == node;
+        }
+    }
+    locality.is_available = true;
+#else
+    (void)data;
+    (void)first;
+    (void)count;
+    (void)total_count;
+    (void)element_size;
+    (void)workers;
+#endif
+    return locality;
+}
+
+std::string transparent_huge_pages_mode()
+{
+    std::ifstream file("/sys/kernel/mm/transparent_hugepage/enabled");
+    std::string   modes;
+    std::getline(file, modes);
+    const std::size_t open  = modes.find('[');
+    const std::size_t close = modes.find(']', open);
+    if (open == std::string::npos || close == std::string::npos)
+        return "unknown";
+    return modes.substr(open + 1, close - open - 1);
+}
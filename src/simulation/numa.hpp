@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+class WorkerPool;
+
+// NUMA nodes of the machine and the CPUs of each, read from sysfs on Linux. Other platforms report a single node.
+class NumaTopology {
+public:
+    static const NumaTopology& get();
+
+    std::size_t get_node_count() const { return m_node_cpus.size(); }
+
+    // Workers are spread over the nodes in proportion to their CPUs, in order, so consecutive slices share a node
+    int node_of_worker(std::size_t worker, std::size_t worker_count) const;
+
+    // Restricts the calling thread to the CPUs of node, does nothing on single-node machines
+    void pin_current_thread(int node) const;
+
+private:
+    std::vector<int>              m_node_ids;
+    std::vector<std::vector<int>> m_node_cpus;
+
+    NumaTopology();
+};
+
+// Where the pages of a large array go. Arrays of at least large_array_bytes are mapped directly, optionally backed by
+// transparent huge pages, and first touched by the workers that own each slice of them in WorkerPool::parallel_for.
+// The kernel then keeps every page on the node of the worker that steers the boids it holds.
+struct NumaPlacement {
+    static constexpr std::size_t large_array_bytes = 64 * 1024;
+    static constexpr std::size_t huge_page_bytes   = 2 * 1024 * 1024;
+
+    WorkerPool* workers    = nullptr; // Pages are touched by the calling thread when null
+    bool        huge_pages = false;
+
+    bool operator==(const NumaPlacement&) const = default;
+};
+
+void* allocate_placed(std::size_t bytes, std::size_t element_size, const NumaPlacement& placement);
+// Same mapping with no page touched yet, for callers that write the memory from the right workers themselves
+void* allocate_untouched(std::size_t bytes, const NumaPlacement& placement);
+void  deallocate_placed(void* memory, std::size_t bytes, const NumaPlacement& placement);
+
+template<typename T>
+class NumaAllocator {
+public:
+    using value_type                             = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap            = std::true_type;
+
+    NumaAllocator() = default;
+    explicit NumaAllocator(const NumaPlacement& placement)
+        : m_placement(placement) {}
+    template<typename U>
+    NumaAllocator(const NumaAllocator<U>& other)
+        : m_placement(other.get_placement()) {}
+
+    T*   allocate(std::size_t count) { return static_cast<T*>(allocate_placed(count * sizeof(T), sizeof(T), m_placement)); }
+    void deallocate(T* memory, std::size_t count) { deallocate_placed(memory, count * sizeof(T), m_placement); }
+
+    const NumaPlacement& get_placement() const { return m_placement; }
+
+    template<typename U>
+    bool operator==(const NumaAllocator<U>& other) const { return m_placement == other.get_placement(); }
+
+private:
+    NumaPlacement m_placement;
+};
+
+template<typename T>
+using NumaVector = std::vector<T, NumaAllocator<T>>;
+
+// How many pages of an array sit on the node of the worker that owns them in parallel_for
+struct NumaLocality {
+    std::size_t local_pages  = 0;
+    std::size_t total_pages  = 0;
+    bool        is_available = false; // false when page nodes cannot be queried
+
+    void  merge(const NumaLocality& other);
+    float local_ratio() const { return total_pages == 0 ? 1.f : static_cast<float>(local_pages) / static_cast<float>(total_pages); }
+};
+
+NumaLocality measure_locality(const void* data, std::size_t count, std::size_t element_size, const WorkerPool& workers);
+// For data holding the elements [first, first + count) of an array of total_count split by parallel_for
+NumaLocality measure_locality(const void* data, std::size_t first, std::size_t count, std::size_t total_count, std::size_t element_size, const WorkerPool& workers);
+
+// State of transparent huge pages as set by the system administrator, "always", "madvise", "never" or "unknown"
+std::string transparent_huge_pages_mode();
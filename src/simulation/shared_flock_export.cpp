@@ -0,0 +1,150 @@
+#include "shared_flock_export.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <utility>
+#include "profiling/profiler.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define BOIDS_HAS_SHARED_MEMORY 1
+#endif
+
+SharedFlockExport::~SharedFlockExport()
+{
+    close();
+}
+
+bool SharedFlockExport::open(const std::string& name, std::size_t capacity, std::size_t slot_count)
+{
+    close();
+#ifdef BOIDS_HAS_SHARED_MEMORY
+    const std::size_t bytes = shared_flock_bytes(slot_count, capacity);
+
+    // A previous run may have crashed before unlinking the object
+    shm_unlink(name.c_str());
+    const int descriptor = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (descriptor < 0)
+    {
+        std::cerr << "Error: could not create shared memory " << name << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    if (ftruncate(descriptor, static_cast<off_t>(bytes)) != 0)
+    {
+        std::cerr << "Error: could not resize shared memory " << name << ": " << std::strerror(errno) << std::endl;
+        ::close(descriptor);
+        shm_unlink(name.c_str());
+        return false;
+    }
+    void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+    ::close(descriptor);
+    if (memory == MAP_FAILED)
+    {
+        std::cerr << "Error: could not map shared memory " << name << ": " << std::strerror(errno) << std::endl;
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    // ftruncate zero-fills the object, so every slot starts with an even sequence and no boids
+    m_header             = new (memory) SharedFlockHeader{};
+    m_header->slot_count = static_cast<std::uint32_t>(slot_count);
+    m_header->capacity   = static_cast<std::uint32_t>(capacity);
+    m_header->slot_bytes = shared_flock_slot_bytes(capacity);
+    for (std::size_t i = 0; i < slot_count; i++)
+    {
+        new (shared_flock_slot(m_header, i)) SharedFlockSlot{};
+    }
+    m_header->version = SharedFlockHeader::expected_version;
+    // Readers check the magic last, once the rest of the header is valid
+    std::atomic_thread_fence(std::memory_order_release);
+    m_header->magic = SharedFlockHeader::expected_magic;
+
+    m_name  = name;
+    m_bytes = bytes;
+    m_next  = 0;
+    std::cout << "Publishing the flock to shared memory " << name << " (" << bytes / 1024 << " KiB)" << std::endl;
+    return true;
+#else
+    (void)capacity;
+    (void)slot_count;
+    std::cerr << "Error: could not create shared memory " << name << ": POSIX shared memory is not available on this platform" << std::endl;
+    return false;
+#endif
+}
+
+void SharedFlockExport::close()
+{
+#ifdef BOIDS_HAS_SHARED_MEMORY
+    if (m_header == nullptr)
+        return;
+
+    // Readers that still have the object mapped keep their mapping, new readers will not find it anymore
+    munmap(m_header, m_bytes);
+    shm_unlink(m_name.c_str());
+    m_header = nullptr;
+#endif
+}
+
+// Replaces the object by one holding at least boid_count boids, under the same name
+bool SharedFlockExport::grow(std::size_t boid_count)
+{
+#ifdef BOIDS_HAS_SHARED_MEMORY
+    PROFILE_ZONE("Shared memory growth");
+    SharedFlockHeader* old_header = std::exchange(m_header, nullptr);
+    const std::size_t  old_bytes  = m_bytes;
+    const std::size_t  capacity   = std::max<std::size_t>(boid_count, 2 * old_header->capacity);
+    const bool         opened     = open(m_name, capacity, old_header->slot_count);
+
+    // Set after the new object exists, so that readers find it when they map the name again
+    old_header->replaced.store(1, std::memory_order_release);
+    munmap(old_header, old_bytes);
+    if (!opened)
+        std::cerr << "Error: the flock outgrew shared memory " << m_name << ", it is not published anymore" << std::endl;
+    return opened;
+#else
+    (void)boid_count;
+    return false;
+#endif
+}
+
+void SharedFlockExport::publish(const Flock& flock)
+{
+    if (m_header == nullptr)
+        return;
+    if (flock.get_boids().size() > m_header->capacity && !grow(flock.get_boids().size()))
+        return;
+    PROFILE_ZONE("Shared memory export");
+    const std::int64_t start_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    const std::size_t   index    = m_next % m_header->slot_count;
+    SharedFlockSlot*    slot     = shared_flock_slot(m_header, index);
+    const std::size_t   capacity = m_header->capacity;
+    const auto&         boids    = flock.get_boids();
+    const std::size_t   count    = std::min(boids.size(), capacity);
+    const std::uint64_t sequence = slot->sequence.load(std::memory_order_relaxed);
+
+    // Odd while writing, the fence keeps the data writes after it
+    slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    float* positions  = shared_flock_positions(slot);
+    float* velocities = shared_flock_velocities(slot, capacity);
+    for (std::size_t i = 0; i < count; i++)
+    {
+        const glm::vec3 position = boids[i].get_position();
+        const glm::vec3 velocity = boids[i].get_velocity();
+        std::copy_n(&position.x, 3, positions + 3 * i);
+        std::copy_n(&velocity.x, 3, velocities + 3 * i);
+    }
+    slot->step       = flock.get_step();
+    slot->boid_count = static_cast<std::uint32_t>(count);
+    slot->publish_ns = start_ns;
+
+    slot->sequence.store(sequence + 2, std::memory_order_release);
+    m_header->published.store(++m_next, std::memory_order_release);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include "flock.hpp"
+#include "shared_flock_layout.hpp"
+
+// Publishes every step of the flock to a POSIX shared-memory ring, for analysis and visualization tools running in
+// other processes. See shared_flock_layout.hpp for the layout and the read protocol, and tools/shared_flock_reader.cpp.
+class SharedFlockExport {
+public:
+    static constexpr std::size_t default_slot_count = 4;
+
+    SharedFlockExport() = default;
+    ~SharedFlockExport();
+    SharedFlockExport(const SharedFlockExport&)            = delete;
+    SharedFlockExport& operator=(const SharedFlockExport&) = delete;
+
+    // name is a POSIX shared-memory name such as "/boids". Flocks larger than capacity replace the object by a larger one.
+    // Returns false, after printing why, when the object cannot be created.
+    bool open(const std::string& name, std::size_t capacity, std::size_t slot_count = default_slot_count);
+    void close();
+
+    bool is_open() const { return m_header != nullptr; }
+
+    // Called by the simulation once a step is complete, never blocks
+    void publish(const Flock& flock);
+
+private:
+    std::string        m_name;
+    SharedFlockHeader* m_header = nullptr;
+    std::size_t        m_bytes  = 0;
+    std::uint64_t      m_next   = 0; // Number of steps published so far
+
+    bool grow(std::size_t boid_count);
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Layout of the POSIX shared-memory object the flock is exported to, see SharedFlockExport.
+// Only standard types are used, so external readers can include this header alone.
+//
+// The object is a header followed by slot_count slots, each holding one step. The writer fills the slots in turn and
+// wraps each write in a seqlock: the sequence is odd while the slot is being written and even once it is stable.
+// Readers map the object read-only and read a slot in place, then check that its sequence did not change meanwhile.
+// The writer never waits for readers, and a slot is only overwritten slot_count steps later, so retries are rare.
+// When the flock outgrows capacity, the writer creates a larger object under the same name, then sets replaced in the
+// old one: readers unmap it and map the name again.
+
+struct SharedFlockHeader {
+    static constexpr std::uint32_t expected_magic   = 0x424F4944; // "BOID"
+    static constexpr std::uint32_t expected_version = 2;
+
+    std::uint32_t magic      = 0;
+    std::uint32_t version    = 0;
+    std::uint32_t slot_count = 0;
+    std::uint32_t capacity   = 0; // Boids per slot
+    std::uint64_t slot_bytes = 0;
+
+    std::atomic<std::uint32_t> replaced{0}; // Set once a larger object took the name, nothing is published here anymore
+
+    // Number of steps published so far, the latest one is in slot (published - 1) % slot_count
+    alignas(64) std::atomic<std::uint64_t> published{0};
+};
+
+struct SharedFlockSlot {
+    alignas(64) std::atomic<std::uint64_t> sequence{0};
+    std::uint64_t step       = 0;
+    std::int64_t  publish_ns = 0; // steady_clock time since epoch when the export of the step started, comparable across processes
+    std::uint32_t boid_count = 0;
+
+    // Followed by capacity positions then capacity velocities, as x, y, z floats
+};
+
+inline constexpr std::size_t shared_flock_slot_bytes(std::size_t capacity)
+{
+    const std::size_t bytes = sizeof(SharedFlockSlot) + 2 * 3 * sizeof(float) * capacity;
+    return (bytes + 63) / 64 * 64;
+}
+
+inline constexpr std::size_t shared_flock_bytes(std::size_t slot_count, std::size_t capacity)
+{
+    return sizeof(SharedFlockHeader) + slot_count * shared_flock_slot_bytes(capacity);
+}
+
+inline SharedFlockSlot* shared_flock_slot(SharedFlockHeader* header, std::size_t index)
+{
+    return reinterpret_cast<SharedFlockSlot*>(reinterpret_cast<std::byte*>(header + 1) + index * header->slot_bytes);
+}
+
+inline const SharedFlockSlot* shared_flock_slot(const SharedFlockHeader* header, std::size_t index)
+{
+    return reinterpret_cast<const SharedFlockSlot*>(reinterpret_cast<const std::byte*>(header + 1) + index * header->slot_bytes);
+}
+
+inline float* shared_flock_positions(SharedFlockSlot* slot)
+{
+    return reinterpret_cast<float*>(slot + 1);
+}
+
+inline const float* shared_flock_positions(const SharedFlockSlot* slot)
+{
+    return reinterpret_cast<const float*>(slot + 1);
+}
+
+inline const float* shared_flock_velocities(const SharedFlockSlot* slot, std::size_t capacity)
+{
+    return shared_flock_positions(slot) + 3 * capacity;
+}
+
+inline float* shared_flock_velocities(SharedFlockSlot* slot, std::size_t capacity)
+{
+    return shared_flock_positions(slot) + 3 * capacity;
+}
@@ -0,0 +1,105 @@
+#include "simulation_thread.hpp"
+#include <chrono>
+#include "profiling/profiler.hpp"
+
+SimulationThread::SimulationThread(std::size_t boid_count, const BoidVariables& variables)
+    : m_flock(boid_count)
+{
+    m_flock.set_variables(variables);
+
+    // The renderer gets a valid snapshot before the first step
+    m_flock.write_snapshot(m_snapshots.write_buffer());
+    m_snapshots.publish();
+}
+
+void SimulationThread::start()
+{
+    if (!m_thread.joinable())
+    {
+        m_thread = std::jthread([this](std::stop_token stop_token) { run(stop_token); });
+    }
+}
+
+void SimulationThread::stop()
+{
+    if (m_thread.joinable())
+    {
+        m_thread.request_stop();
+        m_thread.join();
+    }
+}
+
+void SimulationThread::set_variables(const BoidVariables& variables)
+{
+    m_variables.write_buffer() = variables;
+    m_variables.publish();
+}
+
+void SimulationThread::set_flow_targets(const FlowTargets& targets)
+{
+    // Assigning into the slot keeps its capacity, so the obstacles are not reallocated every frame
+    m_flow_targets.write_buffer() = targets;
+    m_flow_targets.publish();
+}
+
+void SimulationThread::set_boid_count(std::size_t count)
+{
+    m_boid_count.write_buffer() = count;
+    m_boid_count.publish();
+}
+
+const FlockSnapshot& SimulationThread::latest_snapshot()
+{
+    m_snapshots.fetch();
+    return m_snapshots.read_buffer();
+}
+
+void SimulationThread::step()
+{
+    PROFILE_ZONE("Flock step");
+
+    if (m_variables.fetch())
+    {
+        m_flock.set_variables(m_variables.read_buffer());
+    }
+    if (m_flow_targets.fetch())
+    {
+        m_flock.set_flow_targets(m_flow_targets.read_buffer());
+    }
+    if (m_boid_count.fetch())
+    {
+        m_flock.set_boid_count(m_boid_count.read_buffer());
+    }
+
+    const auto start_time = std::chrono::steady_clock::now();
+    m_flock.update();
+    const auto end_time = std::chrono::steady_clock::now();
+
+    FlockSnapshot& snapshot = m_snapshots.write_buffer();
+    m_flock.write_snapshot(snapshot);
+    snapshot.step_ms = std::chrono::duration<double, std::milli>(end_time - start_time).count();
+    m_snapshots.publish();
+    m_shared_export.publish(m_flock);
+}
+
+void SimulationThread::run(std::stop_token stop_token)
+{
+    using clock    = std::chrono::steady_clock;
+    auto next_step = clock::now();
+    Profiler::set_thread_name("Simulation");
+    m_flock.get_workers().pin_caller();
+
+    while (!stop_token.stop_requested())
+    {
+        step();
+
+        const auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1. / m_flock.get_variables().steps_per_second));
+        next_step += period;
+
+        // After a stall, restart the schedule instead of running a burst of catch-up steps
+        const auto now = clock::now();
+        if (next_step < now)
+            next_step = now;
+        std::this_thread::sleep_until(next_step);
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <thread>
+#include "flock.hpp"
+#include "flock_snapshot.hpp"
+#include "shared_flock_export.hpp"
+#include "triple_buffer.hpp"
+
+// Runs the flock on its own thread at BoidVariables::steps_per_second, independently of the frame rate.
+// Parameters go in and snapshots come out through triple buffers, so neither side ever blocks the other.
+class SimulationThread {
+public:
+    SimulationThread(std::size_t boid_count, const BoidVariables& variables);
+
+    void start();
+    void stop();
+
+    // Runs one step on the calling thread, for deterministic replays. Only valid while the thread is stopped.
+    void step_now() { step(); }
+
+    // Also publishes every step to POSIX shared memory for other processes. Only valid while the thread is stopped.
+    bool export_to_shared_memory(const std::string& name) { return m_shared_export.open(name, m_flock.get_boids().size()); }
+
+    // Called from the render thread
+    void                 set_variables(const BoidVariables& variables);
+    void                 set_flow_targets(const FlowTargets& targets);
+    void                 set_boid_count(std::size_t count);
+    const FlockSnapshot& latest_snapshot();
+
+private:
+    Flock                       m_flock;
+    TripleBuffer<BoidVariables> m_variables;
+    TripleBuffer<FlowTargets>   m_flow_targets;
+    TripleBuffer<std::size_t>   m_boid_count;
+    TripleBuffer<FlockSnapshot> m_snapshots;
+    SharedFlockExport           m_shared_export;
+    std::jthread                m_thread;
+
+    void run(std::stop_token stop_token);
+    void step();
+};
@@ -0,0 +1,100 @@
+#include "sparse_grid.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+static std::size_t hash_cell(const glm::ivec3& key)
+{
+    const auto x = static_cast<std::uint32_t>(key.x) * 73856093u;
+    const auto y = static_cast<std::uint32_t>(key.y) * 19349663u;
+    const auto z = static_cast<std::uint32_t>(key.z) * 83492791u;
+    return x ^ y ^ z;
+}
+
+void SparseGrid::build(std::span<const glm::vec3> positions, float radius)
+{
+    m_cell_size     = std::max(radius, 1e-3f);
+    m_inv_cell_size = 1.f / m_cell_size;
+
+    // Sized after the last build, which is usually close, and grown on the way if the flock spread out
+    m_slots.assign(std::max(min_slot_count, std::bit_ceil(2 * m_cells.size())), no_index);
+    m_cells.clear();
+    m_blocks.clear();
+    m_max_cell_occupancy = 0;
+
+    for (std::size_t i = 0; i < positions.size(); i++)
+    {
+        Cell& cell = m_cells[find_or_insert(cell_of(positions[i]))];
+        if (cell.first_block == no_index || m_blocks[cell.first_block].count == block_capacity)
+        {
+            Block& block     = m_blocks.emplace_back();
+            block.next       = cell.first_block;
+            cell.first_block = static_cast<std::uint32_t>(m_blocks.size() - 1);
+        }
+
+        Block& block                 = m_blocks[cell.first_block];
+        block.indices[block.count++] = static_cast<std::uint32_t>(i);
+        cell.count++;
+        m_max_cell_occupancy = std::max<std::size_t>(m_max_cell_occupancy, cell.count);
+    }
+}
+
+void SparseGrid::record_occupancy(FlockStatistics& statistics) const
+{
+    // Every stored cell holds at least one boid
+    statistics.cell_count         = m_cells.size();
+    statistics.occupied_cells     = m_cells.size();
+    statistics.max_cell_occupancy = m_max_cell_occupancy;
+    statistics.grid_bytes         = m_slots.capacity() * sizeof(std::uint32_t) + m_cells.capacity() * sizeof(Cell) + m_blocks.capacity() * sizeof(Block);
+}
+
+glm::ivec3 SparseGrid::cell_of(const glm::vec3& position) const
+{
+    return glm::ivec3(glm::floor(position * m_inv_cell_size));
+}
+
+std::uint32_t SparseGrid::find(const glm::ivec3& key) const
+{
+    const std::size_t mask = m_slots.size() - 1;
+    for (std::size_t slot = hash_cell(key) & mask;; slot = (slot + 1) & mask)
+    {
+        const std::uint32_t cell = m_slots[slot];
+        if (cell == no_index || m_cells[cell].key == key)
+            return cell;
+    }
+}
+
+std::uint32_t SparseGrid::find_or_insert(const glm::ivec3& key)
+{
+    const std::size_t mask = m_slots.size() - 1;
+    std::size_t       slot = hash_cell(key) & mask;
+    for (; m_slots[slot] != no_index; slot = (slot + 1) & mask)
+    {
+        if (m_cells[m_slots[slot]].key == key)
+            return m_slots[slot];
+    }
+
+    const auto cell = static_cast<std::uint32_t>(m_cells.size());
+    m_cells.push_back({key});
+    m_slots[slot] = cell;
+
+    // Probes stay short as long as the table is at most half full
+    if (2 * m_cells.size() > m_slots.size())
+        rehash(2 * m_slots.size());
+    return cell;
+}
+
+void SparseGrid::rehash(std::size_t slot_count)
+{
+    m_slots.assign(slot_count, no_index);
+    const std::size_t mask = slot_count - 1;
+    for (std::uint32_t cell = 0; cell < m_cells.size(); cell++)
+    {
+        std::size_t slot = hash_cell(m_cells[cell].key) & mask;
+        while (m_slots[slot] != no_index)
+        {
+            slot = (slot + 1) & mask;
+        }
+        m_slots[slot] = cell;
+    }
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "flock_statistics.hpp"
+#include "glm/glm.hpp"
+#include "spatial_grid.hpp"
+
+// Grid over unbounded space that only stores its occupied cells, so memory follows the flock rather than the world.
+// An open-addressing table maps cell coordinates to cells, whose boid indices are chained in fixed-size blocks taken
+// from a pool. The table, the cells and the pool keep their capacity between builds, so steady-state builds do not allocate.
+class SparseGrid {
+public:
+    void build(std::span<const glm::vec3> positions, float radius);
+
+    // Copies the cell occupancy and memory use measured by the last build
+    void record_occupancy(FlockStatistics& statistics) const;
+
+    glm::ivec3 cell_of(const glm::vec3& position) const;
+
+    float get_cell_size() const { return m_cell_size; }
+
+    // Position in cells from the origin, for walking the cells along a ray
+    glm::vec3 grid_coordinates(const glm::vec3& position) const { return position * m_inv_cell_size; }
+
+    // Calls visitor(index) for the boids of one cell, missing cells are empty
+    template<typename Visitor>
+    void visit_cell(const glm::ivec3& cell_coordinates, Visitor&& visitor) const
+    {
+        const std::uint32_t cell = find(cell_coordinates);
+        if (cell == no_index)
+            return;
+
+        for (std::uint32_t block = m_cells[cell].first_block; block != no_index; block = m_blocks[block].next)
+        {
+            const Block& indices = m_blocks[block];
+            for (std::uint32_t k = 0; k < indices.count; k++)
+            {
+                visitor(indices.indices[k]);
+            }
+        }
+    }
+
+    // Same order and early stop as SpatialGrid::visit_near_to_far, missing cells are simply skipped
+    template<typename Visitor>
+    void visit_near_to_far(const glm::vec3& position, Visitor&& visitor) const
+    {
+        const glm::ivec3 center = cell_of(position);
+        for (const glm::ivec3& offset : SpatialGrid::near_to_far_offsets)
+        {
+            const std::uint32_t cell = find(center + offset);
+            if (cell == no_index)
+                continue;
+
+            for (std::uint32_t block = m_cells[cell].first_block; block != no_index; block = m_blocks[block].next)
+            {
+                const Block& indices = m_blocks[block];
+                for (std::uint32_t k = 0; k < indices.count; k++)
+                {
+                    if (!visitor(indices.indices[k]))
+                        return;
+                }
+            }
+        }
+    }
+
+    std::size_t count_near(const glm::vec3& position) const
+    {
+        const glm::ivec3 center = cell_of(position);
+        std::size_t      count  = 0;
+        for (const glm::ivec3& offset : SpatialGrid::near_to_far_offsets)
+        {
+            const std::uint32_t cell = find(center + offset);
+            if (cell != no_index)
+                count += m_cells[cell].count;
+        }
+        return count;
+    }
+
+private:
+    static constexpr std::uint32_t no_index       = ~std::uint32_t{0};
+    static constexpr std::size_t   block_capacity = 14;
+    static constexpr std::size_t   min_slot_count = 64;
+
+    struct Cell {
+        glm::ivec3    key;
+        std::uint32_t first_block = no_index; // Newest block, the only one that can be partially filled
+        std::uint32_t count       = 0;
+    };
+
+    // One cache line: the indices, how many are used, and the next block of the same cell
+    struct alignas(64) Block {
+        std::array<std::uint32_t, block_capacity> indices;
+        std::uint32_t                             count = 0;
+        std::uint32_t                             next  = no_index;
+    };
+
+    float m_cell_size     = 1.f;
+    float m_inv_cell_size = 1.f;
+
+    std::size_t m_max_cell_occupancy = 0;
+
+    std::vector<std::uint32_t> m_slots;  // Open-addressing table with linear probing, cell index or no_index
+    std::vector<Cell>          m_cells;  // Occupied cells, in insertion order
+    std::vector<Block>         m_blocks; // Block pool, emptied by every build
+
+    std::uint32_t find(const glm::ivec3& key) const;
+    std::uint32_t find_or_insert(const glm::ivec3& key);
+    void          rehash(std::size_t slot_count);
+};
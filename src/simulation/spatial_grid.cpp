@@ -0,0 +1,81 @@
+#include "spatial_grid.hpp"
+#include <algorithm>
+#include <cmath>
+
+static std::array<glm::ivec3, 27> sorted_neighbor_offsets()
+{
+    std::array<glm::ivec3, 27> offsets;
+    int                        i = 0;
+    for (int z = -1; z <= 1; z++)
+        for (int y = -1; y <= 1; y++)
+            for (int x = -1; x <= 1; x++)
+                offsets[i++] = glm::ivec3(x, y, z);
+
+    std::stable_sort(offsets.begin(), offsets.end(), [](const glm::ivec3& a, const glm::ivec3& b) {
+        return a.x * a.x + a.y * a.y + a.z * a.z < b.x * b.x + b.y * b.y + b.z * b.z;
+    });
+    return offsets;
+}
+
+const std::array<glm::ivec3, 27> SpatialGrid::near_to_far_offsets = sorted_neighbor_offsets();
+
+void SpatialGrid::build(std::span<const glm::vec3> positions, float half_extent, float radius)
+{
+    // Small radii would need huge grids, so the resolution is capped and cells grow instead
+    m_half_extent   = half_extent;
+    m_resolution    = std::clamp(static_cast<int>(2.f * half_extent / std::max(radius, 1e-3f)), 1, max_resolution);
+    m_cell_size     = 2.f * half_extent / static_cast<float>(m_resolution);
+    m_inv_cell_size = 1.f / m_cell_size;
+
+    const std::size_t cell_count = static_cast<std::size_t>(m_resolution) * m_resolution * m_resolution;
+    m_cell_start.assign(cell_count + 1, 0);
+    m_boid_cell.resize(positions.size());
+    m_indices.resize(positions.size());
+
+    for (std::size_t i = 0; i < positions.size(); i++)
+    {
+        const glm::ivec3 c = cell_of(positions[i]);
+        m_boid_cell[i]     = static_cast<std::uint32_t>((c.z * m_resolution + c.y) * m_resolution + c.x);
+        m_cell_start[m_boid_cell[i] + 1]++;
+    }
+    m_occupied_cells     = 0;
+    m_max_cell_occupancy = 0;
+    for (std::size_t c = 0; c < cell_count; c++)
+    {
+        const std::size_t occupancy = m_cell_start[c + 1];
+        m_occupied_cells += occupancy > 0;
+        m_max_cell_occupancy = std::max(m_max_cell_occupancy, occupancy);
+        m_cell_start[c + 1] += m_cell_start[c];
+    }
+
+    m_cursor.assign(m_cell_start.begin(), m_cell_start.end() - 1);
+    for (std::size_t i = 0; i < positions.size(); i++)
+    {
+        m_indices[m_cursor[m_boid_cell[i]]++] = static_cast<std::uint32_t>(i);
+    }
+}
+
+void SpatialGrid::record_occupancy(FlockStatistics& statistics) const
+{
+    statistics.cell_count         = static_cast<std::size_t>(m_resolution) * m_resolution * m_resolution;
+    statistics.occupied_cells     = m_occupied_cells;
+    statistics.max_cell_occupancy = m_max_cell_occupancy;
+    statistics.grid_bytes         = (m_cell_start.capacity() + m_indices.capacity() + m_boid_cell.capacity() + m_cursor.capacity()) * sizeof(std::uint32_t);
+}
+
+glm::ivec3 SpatialGrid::cell_of(const glm::vec3& position) const
+{
+    auto axis = [&](float p) {
+        return std::clamp(static_cast<int>(std::floor((p + m_half_extent) * m_inv_cell_size)), 0, m_resolution - 1);
+    };
+    return {axis(position.x), axis(position.y), axis(position.z)};
+}
+
+std::span<const std::uint32_t> SpatialGrid::cell(const glm::ivec3& cell) const
+{
+    if (cell.x < 0 || cell.y < 0 || cell.z < 0 || cell.x >= m_resolution || cell.y >= m_resolution || cell.z >= m_resolution)
+        return {};
+
+    const std::size_t c = static_cast<std::size_t>((cell.z * m_resolution + cell.y) * m_resolution + cell.x);
+    return {m_indices.data() + m_cell_start[c], m_indices.data() + m_cell_start[c + 1]};
+}
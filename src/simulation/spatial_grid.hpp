@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "flock_statistics.hpp"
+#include "glm/glm.hpp"
+
+// Uniform grid over the cube [-half_extent, half_extent]^3, rebuilt every step with a counting sort.
+// Cells are at least as wide as the radius of awareness, so the 27 cells around a boid hold all its neighbors.
+class SpatialGrid {
+public:
+    static constexpr int max_resolution = 64;
+
+    // The 27 cell offsets around a cell, sorted by distance
+    static const std::array<glm::ivec3, 27> near_to_far_offsets;
+
+    void build(std::span<const glm::vec3> positions, float half_extent, float radius);
+
+    // Copies the cell occupancy and memory use measured by the last build
+    void record_occupancy(FlockStatistics& statistics) const;
+
+    glm::ivec3                     cell_of(const glm::vec3& position) const;
+    std::span<const std::uint32_t> cell(const glm::ivec3& cell) const;
+
+    int   get_resolution() const { return m_resolution; }
+    float get_cell_size() const { return m_cell_size; }
+    float get_half_extent() const { return m_half_extent; }
+
+    // Position in cells from the corner of the grid, not clamped, for walking the cells along a ray
+    glm::vec3 grid_coordinates(const glm::vec3& position) const { return (position + m_half_extent) * m_inv_cell_size; }
+
+    // Calls visitor(index) for the boids of one cell, cells outside the grid are empty
+    template<typename Visitor>
+    void visit_cell(const glm::ivec3& cell_coordinates, Visitor&& visitor) const
+    {
+        for (std::uint32_t index : cell(cell_coordinates))
+        {
+            visitor(index);
+        }
+    }
+
+    // Calls visitor(index) for the boids of the 27 cells around position, own cell first, then faces, edges and corners.
+    // The visitor returns false to stop the search early.
+    template<typename Visitor>
+    void visit_near_to_far(const glm::vec3& position, Visitor&& visitor) const
+    {
+        const glm::ivec3 center = cell_of(position);
+        for (const glm::ivec3& offset : near_to_far_offsets)
+        {
+            for (std::uint32_t index : cell(center + offset))
+            {
+                if (!visitor(index))
+                    return;
+            }
+        }
+    }
+
+    // Number of boids visit_near_to_far() would go through
+    std::size_t count_near(const glm::vec3& position) const
+    {
+        const glm::ivec3 center = cell_of(position);
+        std::size_t      count  = 0;
+        for (const glm::ivec3& offset : near_to_far_offsets)
+        {
+            count += cell(center + offset).size();
+        }
+        return count;
+    }
+
+private:
+    float m_half_extent   = 0.f;
+    float m_cell_size     = 1.f;
+    float m_inv_cell_size = 1.f;
+    int   m_resolution    = 0;
+
+    std::size_t m_occupied_cells     = 0;
+    std::size_t m_max_cell_occupancy = 0;
+
+    std::vector<std::uint32_t> m_cell_start; // Offset of each cell in m_indices, plus a final end offset
+    std::vector<std::uint32_t> m_indices;    // Boid indices sorted by cell
+    std::vector<std::uint32_t> m_boid_cell;  // Cell of each boid, kept between the two passes of build()
+    std::vector<std::uint32_t> m_cursor;     // Insertion point of each cell during build()
+};
@@ -0,0 +1,267 @@
+#include "stream_socket.hpp"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define BOIDS_HAS_SOCKETS 1
+#endif
+
+#ifdef BOIDS_HAS_SOCKETS
+
+static constexpr const char* unix_prefix = "unix:";
+
+static bool is_unix_address(const std::string& address)
+{
+    return address.rfind(unix_prefix, 0) == 0;
+}
+
+static int fail(const std::string& what, const std::string& address)
+{
+    std::cerr << "Error: could not " << what << ' ' << address << ": " << std::strerror(errno) << std::endl;
+    return -1;
+}
+
+static bool make_unix_address(const std::string& address, sockaddr_un& unix_address)
+{
+    const std::string path  = address.substr(std::strlen(unix_prefix));
+    unix_address            = {};
+    unix_address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(unix_address.sun_path))
+    {
+        std::cerr << "Error: invalid Unix socket path in " << address << std::endl;
+        return false;
+    }
+    std::memcpy(unix_address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+// First TCP address of host:port, the caller frees it
+static addrinfo* resolve_tcp(const std::string& address, bool passive)
+{
+    const std::size_t colon = address.rfind(':');
+    const std::string host  = colon == std::string::npos ? "127.0.0.1" : address.substr(0, colon);
+    const std::string port  = colon == std::string::npos ? address : address.substr(colon + 1);
+
+    addrinfo hints{};
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags    = passive ? AI_PASSIVE : 0;
+    addrinfo* result = nullptr;
+    const int status = getaddrinfo(host.c_str(), port.c_str(), &hints, &result);
+    if (status != 0)
+    {
+        std::cerr << "Error: could not resolve " << address << ": " << gai_strerror(status) << std::endl;
+        return nullptr;
+    }
+    return result;
+}
+
+static void set_non_blocking(int socket)
+{
+    fcntl(socket, F_SETFL, fcntl(socket, F_GETFL, 0) | O_NONBLOCK);
+}
+
+static void configure_stream(int socket)
+{
+    // Frames are sent whole, waiting to coalesce them would only add latency
+    const int enabled = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+#ifdef SO_NOSIGPIPE
+    setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, &enabled, sizeof(enabled));
+#endif
+}
+
+int listen_on(const std::string& address)
+{
+    int listener = -1;
+    if (is_unix_address(address))
+    {
+        sockaddr_un unix_address;
+        if (!make_unix_address(address, unix_address))
+            return -1;
+        listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener < 0)
+            return fail("create a socket for", address);
+        unlink(unix_address.sun_path);
+        if (bind(listener, reinterpret_cast<const sockaddr*>(&unix_address), sizeof(unix_address)) != 0)
+        {
+            fail("bind", address);
+            close(listener);
+            return -1;
+        }
+    }
+    else
+    {
+        addrinfo* info = resolve_tcp(address, true);
+        if (info == nullptr)
+            return -1;
+        listener = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+        if (listener < 0)
+        {
+            freeaddrinfo(info);
+            return fail("create a socket for", address);
+        }
+        const int reuse = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        const bool bound = bind(listener, info->ai_addr, info->ai_addrlen) == 0;
+        freeaddrinfo(info);
+        if (!bound)
+        {
+            fail("bind", address);
+            close(listener);
+            return -1;
+        }
+    }
+
+    if (listen(listener, 8) != 0)
+    {
+        fail("listen on", address);
+        close_socket(listener, address);
+        return -1;
+    }
+    set_non_blocking(listener);
+    return listener;
+}
+
+int connect_to(const std::string& address)
+{
+    int connection = -1;
+    if (is_unix_address(address))
+    {
+        sockaddr_un unix_address;
+        if (!make_unix_address(address, unix_address))
+            return -1;
+        connection = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connection < 0)
+            return fail("create a socket for", address);
+        if (connect(connection, reinterpret_cast<const sockaddr*>(&unix_address), sizeof(unix_address)) != 0)
+        {
+            fail("connect to", address);
+            close(connection);
+            return -1;
+        }
+    }
+    else
+    {
+        addrinfo* info = resolve_tcp(address, false);
+        if (info == nullptr)
+            return -1;
+        connection = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+        if (connection < 0)
+        {
+            freeaddrinfo(info);
+            return fail("create a socket for", address);
+        }
+        const bool connected = connect(connection, info->ai_addr, info->ai_addrlen) == 0;
+        freeaddrinfo(info);
+        if (!connected)
+        {
+            fail("connect to", address);
+            close(connection);
+            return -1;
+        }
+        configure_stream(connection);
+    }
+    return connection;
+}
+
+int accept_from(int listener)
+{
+    const int connection = accept(listener, nullptr, nullptr);
+    if (connection < 0)
+        return -1;
+    set_non_blocking(connection);
+    configure_stream(connection);
+    return connection;
+}
+
+long send_some(int socket, const void* data, std::size_t size)
+{
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL;
+#else
+    const int flags = 0;
+#endif
+    const ssize_t sent = send(socket, data, size, flags);
+    if (sent >= 0)
+        return static_cast<long>(sent);
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? 0 : -1;
+}
+
+bool receive_all(int socket, void* data, std::size_t size)
+{
+    auto* bytes = static_cast<char*>(data);
+    while (size > 0)
+    {
+        const ssize_t received = recv(socket, bytes, size, 0);
+        if (received < 0 && errno == EINTR)
+            continue;
+        if (received <= 0)
+            return false;
+        bytes += received;
+        size -= static_cast<std::size_t>(received);
+    }
+    return true;
+}
+
+void shutdown_socket(int socket)
+{
+    shutdown(socket, SHUT_RDWR);
+}
+
+void close_socket(int socket, const std::string& address)
+{
+    if (socket < 0)
+        return;
+    close(socket);
+    sockaddr_un unix_address;
+    if (is_unix_address(address) && make_unix_address(address, unix_address))
+        unlink(unix_address.sun_path);
+}
+
+#else
+
+static int unavailable(const std::string& address)
+{
+    std::cerr << "Error: could not open " << address << ": sockets are not available on this platform" << std::endl;
+    return -1;
+}
+
+int listen_on(const std::string& address)
+{
+    return unavailable(address);
+}
+
+int connect_to(const std::string& address)
+{
+    return unavailable(address);
+}
+
+int accept_from(int)
+{
+    return -1;
+}
+
+long send_some(int, const void*, std::size_t)
+{
+    return -1;
+}
+
+bool receive_all(int, void*, std::size_t)
+{
+    return false;
+}
+
+void shutdown_socket(int) {}
+
+void close_socket(int, const std::string&) {}
+
+#endif
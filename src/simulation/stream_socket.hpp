@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Sockets of the flock stream. An address is either "unix:<path>" for a Unix domain socket,
+// or "<port>" or "<host>:<port>" for TCP, the host defaulting to the loopback interface.
+// Functions return -1, after printing why, when they fail.
+
+// Non-blocking listening socket. A Unix socket path left over by a previous run is replaced.
+int listen_on(const std::string& address);
+
+// Blocking connected socket
+int connect_to(const std::string& address);
+
+// Non-blocking socket of the next pending connection, -1 without printing anything when there is none
+int accept_from(int listener);
+
+// Sends as much of data as the socket takes without blocking. Returns the number of bytes sent, -1 when the peer is gone.
+long send_some(int socket, const void* data, std::size_t size);
+
+// Blocks until size bytes are received. Returns false when the peer is gone or the socket was shut down.
+bool receive_all(int socket, void* data, std::size_t size);
+
+// Wakes up the threads blocked on the socket
+void shutdown_socket(int socket);
+
+// Also removes the path of a listening Unix socket, when address is one
+void close_socket(int socket, const std::string& address = {});
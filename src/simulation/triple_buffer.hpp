@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single producer / single consumer triple buffer.
+// The writer fills write_buffer() then publishes it, the reader fetches the latest published slot and reads it in place.
+// Each side owns its slot exclusively, so neither ever waits for the other nor copies the value.
+template<typename T>
+class TripleBuffer {
+public:
+    // Writer side
+    T& write_buffer() { return m_slots[m_back]; }
+
+    void publish()
+    {
+        const std::uint8_t previous = m_middle.exchange(static_cast<std::uint8_t>(m_back | fresh_bit), std::memory_order_acq_rel);
+        m_back                      = previous & index_mask;
+    }
+
+    // Reader side, returns true when a newer value was published since the last fetch
+    bool fetch()
+    {
+        if ((m_middle.load(std::memory_order_relaxed) & fresh_bit) == 0)
+            return false;
+
+        const std::uint8_t previous = m_middle.exchange(m_front, std::memory_order_acq_rel);
+        m_front                     = previous & index_mask;
+        return true;
+    }
+
+    const T& read_buffer() const { return m_slots[m_front]; }
+
+private:
+    static constexpr std::uint8_t index_mask = 0x3;
+    static constexpr std::uint8_t fresh_bit  = 0x4;
+
+    std::array<T, 3> m_slots{};
+
+    // Each index lives on its own cache line so the two threads do not false-share
+    alignas(64) std::atomic<std::uint8_t> m_middle{1};
+    alignas(64) std::uint8_t m_back  = 0;
+    alignas(64) std::uint8_t m_front = 2;
+};
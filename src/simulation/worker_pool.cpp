@@ -0,0 +1,99 @@
+#include "worker_pool.hpp"
+#include <algorithm>
+#include "numa.hpp"
+
+WorkerPool::WorkerPool(std::size_t worker_count)
+    : m_worker_count(std::max<std::size_t>(worker_count, 1))
+{
+    for (std::size_t worker = 1; worker < m_worker_count; worker++)
+    {
+        m_threads.emplace_back([this, worker] { run(worker); });
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+    m_task_ready.notify_all();
+    for (auto& thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+int WorkerPool::get_worker_node(std::size_t worker) const
+{
+    return NumaTopology::get().node_of_worker(worker, m_worker_count);
+}
+
+void WorkerPool::pin_caller() const
+{
+    NumaTopology::get().pin_current_thread(get_worker_node(0));
+}
+
+void WorkerPool::run_slice(const Task& task, std::size_t count, std::size_t worker, std::size_t worker_count)
+{
+    const std::size_t begin = count * worker / worker_count;
+    const std::size_t end   = count * (worker + 1) / worker_count;
+    if (begin < end)
+        task(begin, end, worker);
+}
+
+void WorkerPool::parallel_for(std::size_t count, const Task& task, std::size_t min_parallel_count)
+{
+    if (m_threads.empty() || count < min_parallel_count)
+    {
+        if (count > 0)
+            task(0, count, 0);
+        return;
+    }
+
+    {
+        std::lock_guard lock(m_mutex);
+        m_task    = &task;
+        m_count   = count;
+        m_pending = m_threads.size();
+        m_generation++;
+    }
+    m_task_ready.notify_all();
+
+    run_slice(task, count, 0, get_worker_count());
+
+    std::unique_lock lock(m_mutex);
+    m_task_done.wait(lock, [this] { return m_pending == 0; });
+    m_task = nullptr;
+}
+
+void WorkerPool::run(std::size_t worker)
+{
+    NumaTopology::get().pin_current_thread(get_worker_node(worker));
+
+    std::size_t seen_generation = 0;
+    while (true)
+    {
+        const Task* task  = nullptr;
+        std::size_t count = 0;
+        {
+            std::unique_lock lock(m_mutex);
+            m_task_ready.wait(lock, [&] { return m_stopping || m_generation != seen_generation; });
+            if (m_stopping)
+                return;
+            seen_generation = m_generation;
+            task            = m_task;
+            count           = m_count;
+        }
+
+        run_slice(*task, count, worker, get_worker_count());
+
+        bool last = false;
+        {
+            std::lock_guard lock(m_mutex);
+            last = --m_pending == 0;
+        }
+        if (last)
+            m_task_done.notify_one();
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of threads running one data-parallel loop at a time.
+// Ranges are split statically, so a given worker always gets the same slice of a same-sized loop.
+// On NUMA machines every worker thread is pinned to a node, see NumaTopology::node_of_worker. The calling thread runs
+// the slices of worker 0 but is left where it is, as it may be the thread of the GUI: see pin_caller().
+class WorkerPool {
+public:
+    using Task = std::function<void(std::size_t begin, std::size_t end, std::size_t worker)>;
+
+    // worker_count includes the calling thread, which takes the first slice
+    explicit WorkerPool(std::size_t worker_count = std::thread::hardware_concurrency());
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&)            = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    std::size_t get_worker_count() const { return m_threads.size() + 1; }
+    int         get_worker_node(std::size_t worker) const;
+
+    // Pins the calling thread to the node of worker 0. For the threads dedicated to stepping the flock, once they start.
+    void pin_caller() const;
+
+    // Runs task over [0, count) and returns once every slice is done.
+    // Loops shorter than min_parallel_count run on the calling thread alone.
+    void parallel_for(std::size_t count, const Task& task, std::size_t min_parallel_count = 512);
+
+private:
+    std::vector<std::thread> m_threads;
+    std::size_t              m_worker_count;
+    std::mutex               m_mutex;
+    std::condition_variable  m_task_ready;
+    std::condition_variable  m_task_done;
+
+    const Task* m_task       = nullptr;
+    std::size_t m_count      = 0;
+    std::size_t m_generation = 0;
+    std::size_t m_pending    = 0;
+    bool        m_stopping   = false;
+
+    void        run(std::size_t worker);
+    static void run_slice(const Task& task, std::size_t count, std::size_t worker, std::size_t worker_count);
+};
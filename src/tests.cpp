@@ -1,4 +1,45 @@
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <span>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "3D_loader/mesh_optimizer.hpp"
+#include "3D_loader/vertex_packing.hpp"
 #include "doctest/doctest.h"
+#include "glm/glm.hpp"
+#include "glm/gtc/packing.hpp"
+#include "maths/counter_rng.hpp"
+#include "maths/percentile.hpp"
+#include "render/quality_controller.hpp"
+#include "render/render_queue.hpp"
+#include "render/streaming_buffer.hpp"
+#include "scenario/scenario.hpp"
+#include "simulation/boid_pool.hpp"
+#include "simulation/flock.hpp"
+#include "simulation/flock_index.hpp"
+#include "simulation/flock_stream_codec.hpp"
+#include "simulation/neighbor_list.hpp"
+#include "simulation/shared_flock_export.hpp"
+#include "simulation/sparse_grid.hpp"
+#include "simulation/spatial_grid.hpp"
+#include "simulation/triple_buffer.hpp"
+#include "simulation/worker_pool.hpp"
 
 // This is just an example of how to use Doctest in order to write tests.
 // To learn more about Doctest, see https://github.com/doctest/doctest/blob/master/doc/markdown/tutorial.md
@@ -6,4 +47,1060 @@ TEST_CASE("Addition is commutative")
 {
     CHECK(1 + 2 == 2 + 1);
     CHECK(4 + 7 == 7 + 4);
-}
\ No newline at end of file
+}
+
+// ---TripleBuffer---
+
+TEST_CASE("TripleBuffer fetches only the latest published value")
+{
+    TripleBuffer<int> buffer;
+    CHECK_FALSE(buffer.fetch()); // Nothing published yet
+
+    buffer.write_buffer() = 1;
+    buffer.publish();
+    buffer.write_buffer() = 2;
+    buffer.publish();
+    REQUIRE(buffer.fetch());
+    CHECK(buffer.read_buffer() == 2);
+
+    // The value stays readable until a newer one is published
+    CHECK_FALSE(buffer.fetch());
+    CHECK(buffer.read_buffer() == 2);
+}
+
+TEST_CASE("TripleBuffer never hands the slot being read to the writer")
+{
+    TripleBuffer<int> buffer;
+    buffer.write_buffer() = 1;
+    buffer.publish();
+    REQUIRE(buffer.fetch());
+    const int* read_slot = &buffer.read_buffer();
+
+    for (int value = 2; value <= 10; value++)
+    {
+        CHECK(&buffer.write_buffer() != read_slot);
+        buffer.write_buffer() = value;
+        buffer.publish();
+    }
+    CHECK(*read_slot == 1);
+    REQUIRE(buffer.fetch());
+    CHECK(buffer.read_buffer() == 10);
+}
+
+TEST_CASE("TripleBuffer publishes whole values in order across threads")
+{
+    struct Pair {
+        int first  = 0;
+        int second = 0;
+    };
+    constexpr int      last_value = 100000;
+    TripleBuffer<Pair> buffer;
+
+    std::thread writer([&]() {
+        for (int value = 1; value <= last_value; value++)
+        {
+            buffer.write_buffer() = {value, value};
+            buffer.publish();
+        }
+    });
+
+    int  previous  = 0;
+    bool torn      = false;
+    bool backwards = false;
+    while (previous != last_value)
+    {
+        if (!buffer.fetch())
+            continue;
+        const Pair& pair = buffer.read_buffer();
+        torn |= pair.first != pair.second;
+        backwards |= pair.first <= previous;
+        previous = pair.first;
+    }
+    writer.join();
+    CHECK_FALSE(torn);
+    CHECK_FALSE(backwards);
+}
+
+// ---Percentiles---
+
+TEST_CASE("percentile_index gives the nearest rank")
+{
+    // Samples 1 to 100: the p-th percentile is p itself
+    CHECK(percentile_index(100, 50.) == 49);
+    CHECK(percentile_index(100, 95.) == 94);
+    CHECK(percentile_index(100, 99.) == 98);
+    CHECK(percentile_index(100, 100.) == 99);
+    CHECK(percentile_index(100, 0.) == 0);
+
+    // Otherwise rounded up to the next sample
+    CHECK(percentile_index(10, 95.) == 9);
+    CHECK(percentile_index(7, 50.) == 3);
+    CHECK(percentile_index(1, 99.) == 0);
+    CHECK(percentile_index(0, 50.) == 0);
+}
+
+TEST_CASE("ScenarioReport prints the nearest-rank percentiles of the frames")
+{
+    ScenarioReport report;
+    for (int frame = 100; frame >= 1; frame--)
+    {
+        report.add_frame(static_cast<double>(frame), {});
+    }
+    std::ostringstream out;
+    report.print(out);
+    CHECK(out.str().find("50.000    95.000    99.000       100") != std::string::npos);
+}
+
+// ---NeighborList---
+
+// Boids on a lattice of side³ points around the origin
+static std::vector<glm::vec3> lattice_positions(int side, float spacing)
+{
+    std::vector<glm::vec3> positions;
+    for (int x = 0; x < side; x++)
+    {
+        for (int y = 0; y < side; y++)
+        {
+            for (int z = 0; z < side; z++)
+            {
+                positions.emplace_back((static_cast<float>(x) - side / 2.f) * spacing, (static_cast<float>(y) - side / 2.f) * spacing, (static_cast<float>(z) - side / 2.f) * spacing);
+            }
+        }
+    }
+    return positions;
+}
+
+TEST_CASE("NeighborList keeps every boid within the radius of each boid")
+{
+    constexpr float        radius    = 1.f;
+    constexpr float        skin      = 0.5f;
+    std::vector<glm::vec3> positions = lattice_positions(6, 0.7f);
+    WorkerPool             workers(2);
+    SpatialGrid            grid;
+    grid.build(positions, 5.f, radius + skin);
+    NeighborList list;
+    list.build(positions, grid, radius, skin, workers);
+
+    bool missing = false;
+    for (std::size_t i = 0; i < positions.size(); i++)
+    {
+        const std::span<const std::uint32_t> neighbors = list.neighbors_of(i);
+        for (std::size_t j = 0; j < positions.size(); j++)
+        {
+            if (glm::distance(positions[i], positions[j]) < radius)
+                missing |= std::find(neighbors.begin(), neighbors.end(), static_cast<std::uint32_t>(j)) == neighbors.end();
+        }
+    }
+    CHECK_FALSE(missing);
+}
+
+TEST_CASE("NeighborList is rebuilt when the radius, the skin or the boid count changes")
+{
+    constexpr float        radius    = 1.f;
+    constexpr float        skin      = 0.5f;
+    std::vector<glm::vec3> positions = lattice_positions(4, 0.7f);
+    WorkerPool             workers(1);
+    SpatialGrid            grid;
+    NeighborList           list;
+    CHECK(list.update(positions, radius, skin, workers)); // Never built
+
+    grid.build(positions, 5.f, radius + skin);
+    list.build(positions, grid, radius, skin, workers);
+    CHECK_FALSE(list.update(positions, radius, skin, workers));
+    CHECK(list.update(positions, 2.f * radius, skin, workers));
+    CHECK(list.update(positions, radius, 2.f * skin, workers));
+    positions.pop_back();
+    CHECK(list.update(positions, radius, skin, workers));
+}
+
+TEST_CASE("NeighborList reuses the list until too many boids moved half the skin")
+{
+    constexpr float        radius    = 1.f;
+    constexpr float        skin      = 0.5f;
+    std::vector<glm::vec3> positions = lattice_positions(6, 0.7f);
+    WorkerPool             workers(1);
+    SpatialGrid            grid;
+    grid.build(positions, 5.f, radius + skin);
+    NeighborList list;
+    list.build(positions, grid, radius, skin, workers);
+
+    // Everyone moved, but less than skin / 2
+    std::vector<glm::vec3> moved = positions;
+    for (glm::vec3& position : moved)
+    {
+        position.x += 0.2f;
+    }
+    CHECK_FALSE(list.update(moved, radius, skin, workers));
+    CHECK(list.get_roaming().empty());
+
+    // A single boid went further, it roams rather than forcing a rebuild
+    moved[7].y += 3.f;
+    CHECK_FALSE(list.update(moved, radius, skin, workers));
+    REQUIRE(list.get_roaming().size() == 1);
+    CHECK(list.get_roaming()[0] == 7);
+    CHECK(list.is_roaming(7));
+    CHECK_FALSE(list.is_roaming(8));
+
+    // Past max_roaming, rebuilding is cheaper
+    for (std::size_t i = 0; i <= NeighborList::max_roaming; i++)
+    {
+        moved[i].z += 3.f;
+    }
+    CHECK(list.update(moved, radius, skin, workers));
+}
+
+// ---SparseGrid---
+
+static std::vector<glm::vec3> random_positions(std::size_t count, float half_extent, unsigned seed)
+{
+    std::mt19937                          engine(seed);
+    std::uniform_real_distribution<float> coordinate(-half_extent, half_extent);
+    std::vector<glm::vec3>                positions(count);
+    for (glm::vec3& position : positions)
+    {
+        position = glm::vec3(coordinate(engine), coordinate(engine), coordinate(engine));
+    }
+    return positions;
+}
+
+template<typename Grid>
+static std::vector<std::uint32_t> visited_near(const Grid& grid, const glm::vec3& position)
+{
+    std::vector<std::uint32_t> visited;
+    grid.visit_near_to_far(position, [&](std::uint32_t index) {
+        visited.push_back(index);
+        return true;
+    });
+    return visited;
+}
+
+TEST_CASE("SparseGrid finds the same boids as the dense grid")
+{
+    // Cells of 1 on both grids, the dense one from -5 so that their cells line up
+    constexpr float              half_extent = 5.f;
+    constexpr float              radius      = 1.f;
+    const std::vector<glm::vec3> positions   = random_positions(2000, half_extent - 0.01f, 34);
+    SpatialGrid                  dense;
+    dense.build(positions, half_extent, radius);
+    SparseGrid sparse;
+    sparse.build(positions, radius);
+    REQUIRE(dense.get_cell_size() == doctest::Approx(sparse.get_cell_size()));
+
+    bool different_sets  = false;
+    bool different_order = false;
+    bool different_count = false;
+    for (const glm::vec3& position : random_positions(200, half_extent - 0.01f, 340))
+    {
+        std::vector<std::uint32_t> from_dense  = visited_near(dense, position);
+        std::vector<std::uint32_t> from_sparse = visited_near(sparse, position);
+        different_count |= sparse.count_near(position) != from_sparse.size() || dense.count_near(position) != from_dense.size();
+
+        // Cells come in the same near-to-far order, boids may not be in the same order within a cell
+        std::vector<glm::ivec3> dense_cells;
+        std::vector<glm::ivec3> sparse_cells;
+        for (std::uint32_t index : from_dense)
+        {
+            dense_cells.push_back(dense.cell_of(positions[index]) - dense.cell_of(position));
+        }
+        for (std::uint32_t index : from_sparse)
+        {
+            sparse_cells.push_back(sparse.cell_of(positions[index]) - sparse.cell_of(position));
+        }
+        different_order |= dense_cells != sparse_cells;
+
+        std::sort(from_dense.begin(), from_dense.end());
+        std::sort(from_sparse.begin(), from_sparse.end());
+        different_sets |= from_dense != from_sparse;
+    }
+    CHECK_FALSE(different_sets);
+    CHECK_FALSE(different_order);
+    CHECK_FALSE(different_count);
+}
+
+TEST_CASE("SparseGrid chains crowded cells and forgets the previous build")
+{
+    constexpr float radius = 1.f;
+    SparseGrid      grid;
+
+    // More boids in one cell than a block holds
+    std::vector<glm::vec3> crowded(100, glm::vec3(0.5f, 0.5f, 0.5f));
+    crowded.emplace_back(100.5f, -200.5f, 0.5f); // Far away, in a cell of its own
+    grid.build(crowded, radius);
+    std::vector<std::uint32_t> in_cell;
+    grid.visit_cell(glm::ivec3(0, 0, 0), [&](std::uint32_t index) { in_cell.push_back(index); });
+    std::sort(in_cell.begin(), in_cell.end());
+    REQUIRE(in_cell.size() == 100);
+    CHECK(in_cell.front() == 0);
+    CHECK(in_cell.back() == 99);
+    CHECK(visited_near(grid, glm::vec3(100.5f, -200.5f, 0.5f)) == std::vector<std::uint32_t>{100});
+
+    // Stopping early stops the whole search
+    std::size_t visit_count = 0;
+    grid.visit_near_to_far(glm::vec3(0.5f, 0.5f, 0.5f), [&](std::uint32_t /*index*/) { return ++visit_count < 20; });
+    CHECK(visit_count == 20);
+
+    // A new build only holds the new boids
+    const std::vector<glm::vec3> moved{glm::vec3(3.5f, 3.5f, 3.5f)};
+    grid.build(moved, radius);
+    CHECK(grid.count_near(glm::vec3(0.5f, 0.5f, 0.5f)) == 0);
+    CHECK(grid.count_near(glm::vec3(100.5f, -200.5f, 0.5f)) == 0);
+    CHECK(visited_near(grid, glm::vec3(3.5f, 3.5f, 3.5f)) == std::vector<std::uint32_t>{0});
+}
+
+// ---CounterRng---
+
+TEST_CASE("CounterRng::fill draws the same values as next_float")
+{
+    CounterRng         one_by_one(37, 5);
+    CounterRng         filled(37, 5);
+    std::vector<float> values(1000);
+
+    // Uneven sizes, so that the wide loops also end on partial registers
+    bool              different = false;
+    bool              in_range  = true;
+    const std::size_t sizes[]   = {1, 7, 16, 33, 943};
+    std::size_t       first     = 0;
+    for (const std::size_t size : sizes)
+    {
+        filled.fill(std::span<float>(values).subspan(first, size));
+        first += size;
+    }
+    for (const float value : values)
+    {
+        different |= value != one_by_one.next_float();
+        in_range &= value >= 0.f && value < 1.f;
+    }
+    CHECK_FALSE(different);
+    CHECK(in_range);
+
+    // Both continue from the same counter
+    CHECK(filled.next_u64() == one_by_one.next_u64());
+}
+
+TEST_CASE("CounterRng streams only depend on their seed and stream")
+{
+    CounterRng first(1, 2);
+    CounterRng same(1, 2);
+    CounterRng other_stream(1, 3);
+    CounterRng other_seed(2, 2);
+    const std::uint64_t a = first.next_u64();
+    CHECK(a == same.next_u64());
+    CHECK(a != other_stream.next_u64());
+    CHECK(a != other_seed.next_u64());
+}
+
+// ---BoidPool---
+
+// The i-th boid spawned is at x = first + i, so boids can be told apart after they moved
+static void spawn_numbered(BoidPool& pool, std::size_t count, float first)
+{
+    pool.spawn(count, [&](std::size_t i) { return Boid(glm::vec3(first + static_cast<float>(i), 0.f, 0.f), glm::vec3(0.f), Color(1.f)); });
+}
+
+TEST_CASE("BoidPool grows by chunks without moving the boids already there")
+{
+    BoidPool pool;
+    spawn_numbered(pool, BoidPool::chunk_size - 1, 0.f);
+    CHECK(pool.get_chunk_count() == 1);
+    const Boid* first = &pool[0];
+    const Boid* last  = &pool[BoidPool::chunk_size - 2];
+
+    spawn_numbered(pool, 2, static_cast<float>(BoidPool::chunk_size - 1));
+    CHECK(pool.size() == BoidPool::chunk_size + 1);
+    CHECK(pool.get_chunk_count() == 2);
+    CHECK(&pool[0] == first);
+    CHECK(&pool[BoidPool::chunk_size - 2] == last);
+
+    bool in_order = true;
+    for (std::size_t i = 0; i < pool.size(); i++)
+    {
+        in_order &= pool[i].get_position().x == static_cast<float>(i);
+    }
+    CHECK(in_order);
+}
+
+TEST_CASE("BoidPool::swap_remove moves the last boid across the chunk boundary")
+{
+    BoidPool pool;
+    spawn_numbered(pool, BoidPool::chunk_size + 2, 0.f);
+    const float last = static_cast<float>(BoidPool::chunk_size + 1);
+
+    pool.swap_remove(3);
+    CHECK(pool.size() == BoidPool::chunk_size + 1);
+    CHECK(pool[3].get_position().x == last);
+    CHECK(pool[2].get_position().x == 2.f);
+    CHECK(pool[BoidPool::chunk_size].get_position().x == static_cast<float>(BoidPool::chunk_size));
+
+    // Out of range, nothing happens
+    pool.swap_remove(pool.size());
+    CHECK(pool.size() == BoidPool::chunk_size + 1);
+
+    // Removing the last boid moves nothing
+    pool.swap_remove(pool.size() - 1);
+    CHECK(pool.size() == BoidPool::chunk_size);
+    CHECK(pool[BoidPool::chunk_size - 1].get_position().x == static_cast<float>(BoidPool::chunk_size - 1));
+}
+
+TEST_CASE("BoidPool::despawn_last keeps emptied chunks for the next spawns")
+{
+    BoidPool pool;
+    spawn_numbered(pool, 2 * BoidPool::chunk_size + 5, 0.f);
+    REQUIRE(pool.get_chunk_count() == 3);
+    const Boid* second_chunk = &pool[BoidPool::chunk_size];
+
+    pool.despawn_last(BoidPool::chunk_size + 10);
+    CHECK(pool.size() == BoidPool::chunk_size - 5);
+    CHECK(pool.get_chunk_count() == 3);
+    CHECK(pool[BoidPool::chunk_size - 6].get_position().x == static_cast<float>(BoidPool::chunk_size - 6));
+
+    // Respawning fills the chunks already there, at the same addresses
+    spawn_numbered(pool, 2 * BoidPool::chunk_size, -1.f);
+    CHECK(pool.get_chunk_count() == 3);
+    CHECK(&pool[BoidPool::chunk_size] == second_chunk);
+    CHECK(pool[BoidPool::chunk_size - 5].get_position().x == -1.f);
+    CHECK(pool[BoidPool::chunk_size].get_position().x == 4.f);
+
+    // Despawning more boids than there are empties the pool
+    pool.despawn_last(pool.size() + 1);
+    CHECK(pool.empty());
+    CHECK(pool.get_chunk_count() == 3);
+}
+
+// ---SharedFlockExport---
+
+#if defined(__unix__) || defined(__APPLE__)
+// Maps the object published under name as a reader would, nullptr when there is none
+static const SharedFlockHeader* map_shared_flock(const std::string& name)
+{
+    const int descriptor = shm_open(name.c_str(), O_RDONLY, 0);
+    if (descriptor < 0)
+        return nullptr;
+    struct stat status {};
+    fstat(descriptor, &status);
+    void* memory = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_SHARED, descriptor, 0);
+    close(descriptor);
+    return memory == MAP_FAILED ? nullptr : static_cast<const SharedFlockHeader*>(memory);
+}
+
+TEST_CASE("SharedFlockExport replaces its object when the flock outgrows it")
+{
+    const std::string name = "/boids_test_" + std::to_string(getpid());
+    Flock             flock(10);
+    SharedFlockExport shared_export;
+    REQUIRE(shared_export.open(name, flock.get_boids().size()));
+    const SharedFlockHeader* small = map_shared_flock(name);
+    REQUIRE(small != nullptr);
+    shared_export.publish(flock);
+    CHECK(shared_flock_slot(small, 0)->boid_count == 10);
+
+    flock.set_boid_count(100);
+    shared_export.publish(flock);
+    CHECK(small->replaced.load() == 1);
+    CHECK(small->published.load() == 1);
+
+    const SharedFlockHeader* large = map_shared_flock(name);
+    REQUIRE(large != nullptr);
+    CHECK(large->magic == SharedFlockHeader::expected_magic);
+    CHECK(large->capacity >= 100);
+    CHECK(large->replaced.load() == 0);
+    CHECK(large->published.load() == 1);
+    CHECK(shared_flock_slot(large, 0)->boid_count == 100);
+
+    munmap(const_cast<SharedFlockHeader*>(small), shared_flock_bytes(small->slot_count, small->capacity));
+    munmap(const_cast<SharedFlockHeader*>(large), shared_flock_bytes(large->slot_count, large->capacity));
+}
+#endif
+
+// ---QualityController---
+
+TEST_CASE("QualityController holds a frozen level whatever the frame times")
+{
+    QualityController quality;
+    CHECK(quality.get_level_index() == 0);
+
+    quality.freeze_at(3);
+    bool changed = false;
+    for (int frame = 0; frame < 4 * QualityController::improve_frames; frame++)
+    {
+        changed |= quality.add_frame(frame < QualityController::improve_frames ? 1000. : 0.1);
+    }
+    CHECK_FALSE(changed);
+    CHECK(quality.get_level_index() == 3);
+
+    quality.freeze_at(QualityController::level_count + 2);
+    CHECK(quality.get_level_index() == QualityController::level_count - 1);
+}
+
+// ---FlockIndex---
+
+// Nearest boid crossed by the ray, by testing them all
+static std::optional<RayHit> raycast_all(const std::vector<glm::vec3>& positions, const glm::vec3& origin, const glm::vec3& direction, float max_distance, float boid_radius)
+{
+    std::optional<RayHit> hit;
+    for (std::size_t i = 0; i < positions.size(); i++)
+    {
+        const glm::vec3 to_center = positions[i] - origin;
+        const float     closest   = glm::dot(to_center, direction);
+        const float     miss2     = glm::dot(to_center, to_center) - closest * closest;
+        if (miss2 > boid_radius * boid_radius)
+            continue;
+        const float half_chord = std::sqrt(boid_radius * boid_radius - miss2);
+        const float distance   = std::max(closest - half_chord, 0.f);
+        if (closest + half_chord >= 0.f && distance <= max_distance && (!hit || distance < hit->distance))
+            hit = RayHit{static_cast<std::uint32_t>(i), distance};
+    }
+    return hit;
+}
+
+// Compares the queries of the index with linear scans, for rays and regions spread over [-reach, reach]
+static void check_flock_index(const std::vector<glm::vec3>& positions, float half_extent, bool unbounded, float reach, unsigned seed)
+{
+    FlockIndex index;
+    index.build(positions, half_extent, unbounded);
+
+    std::mt19937                          engine(seed);
+    std::uniform_real_distribution<float> coordinate(-reach, reach);
+    std::uniform_real_distribution<float> size(0.2f, 4.f);
+    auto                                  random_point = [&]() { return glm::vec3(coordinate(engine), coordinate(engine), coordinate(engine)); };
+
+    // Random rays, rays along each axis both ways, and rays aimed at boids from 2 * reach away along an axis
+    std::vector<std::pair<glm::vec3, glm::vec3>> rays;
+    for (int i = 0; i < 300; i++)
+    {
+        const glm::vec3 direction = random_point();
+        if (glm::dot(direction, direction) > 1e-6f)
+            rays.emplace_back(random_point(), glm::normalize(direction));
+    }
+    for (int axis = 0; axis < 3; axis++)
+    {
+        for (int i = 0; i < 30; i++)
+        {
+            glm::vec3 direction(0.f);
+            direction[axis] = i % 2 == 0 ? 1.f : -1.f;
+            rays.emplace_back(random_point(), direction);
+            rays.emplace_back(positions[rays.size()] - 2.f * reach * direction, direction);
+        }
+    }
+
+    bool        rays_match = true;
+    std::size_t hits       = 0;
+    for (const auto& [origin, direction] : rays)
+    {
+        const std::optional<RayHit> expected = raycast_all(positions, origin, direction, 4.f * reach, 0.4f);
+        const std::optional<RayHit> found    = index.raycast(positions, origin, direction, 4.f * reach, 0.4f);
+        rays_match &= expected.has_value() == found.has_value();
+        if (expected && found)
+        {
+            // Rays starting inside several boids hit any of them at 0
+            rays_match &= found->distance == doctest::Approx(expected->distance) && (found->index == expected->index || expected->distance == 0.f);
+            hits++;
+        }
+    }
+    CHECK(rays_match);
+    CHECK(hits > rays.size() / 4); // Not only misses
+
+    bool counts_match = true;
+    for (int i = 0; i < 100; i++)
+    {
+        const glm::vec3 center = random_point();
+        const float     radius = size(engine);
+        const glm::vec3 min    = center - glm::vec3(size(engine), size(engine), size(engine));
+        const glm::vec3 max    = center + glm::vec3(size(engine), size(engine), size(engine));
+
+        std::size_t in_sphere = 0;
+        std::size_t in_box    = 0;
+        for (const glm::vec3& p : positions)
+        {
+            in_sphere += glm::dot(p - center, p - center) <= radius * radius ? 1 : 0;
+            in_box += p.x >= min.x && p.y >= min.y && p.z >= min.z && p.x <= max.x && p.y <= max.y && p.z <= max.z ? 1 : 0;
+        }
+        counts_match &= index.count_in_sphere(positions, center, radius) == in_sphere;
+        counts_match &= index.count_in_box(positions, min, max) == in_box;
+    }
+    CHECK(counts_match);
+}
+
+TEST_CASE("FlockIndex queries in the cube match linear scans")
+{
+    // Rays and regions also start outside of the cube
+    constexpr float half_extent = 5.f;
+    check_flock_index(random_positions(3000, half_extent - 0.01f, 42), half_extent, false, 1.5f * half_extent, 420);
+}
+
+TEST_CASE("FlockIndex queries in an unbounded world match linear scans")
+{
+    check_flock_index(random_positions(3000, 12.f, 43), 5.f, true, 14.f, 430);
+}
+
+// ---Flock stream---
+
+TEST_CASE("Varints round trip at the edges of their byte counts")
+{
+    const std::int32_t values[] = {0, 1, -1, 63, -64, 64, -65, 8191, 8192, std::numeric_limits<std::int32_t>::max(), std::numeric_limits<std::int32_t>::min()};
+    const std::size_t  sizes[]  = {1, 1, 1, 1, 1, 2, 2, 2, 3, 5, 5};
+    for (std::size_t i = 0; i < std::size(values); i++)
+    {
+        std::vector<std::uint8_t> out;
+        write_varint(out, values[i]);
+        CHECK(out.size() == sizes[i]);
+
+        const std::uint8_t* cursor = out.data();
+        std::int32_t        value  = 0;
+        REQUIRE(read_varint(cursor, out.data() + out.size(), value));
+        CHECK(value == values[i]);
+        CHECK(cursor == out.data() + out.size());
+
+        // Cut before its last byte, the varint cannot be read
+        cursor = out.data();
+        CHECK_FALSE(read_varint(cursor, out.data() + out.size() - 1, value));
+    }
+}
+
+// Decodes a whole frame, header included, as FlockStreamEncoder writes them
+static bool decode_frame(FlockStreamDecoder& decoder, const std::vector<std::uint8_t>& frame, FlockSnapshot& snapshot)
+{
+    FlockStreamHeader header;
+    std::memcpy(&header, frame.data(), sizeof(header));
+    return decoder.decode(header, std::span<const std::uint8_t>(frame).subspan(sizeof(header)), snapshot);
+}
+
+static bool within_quantum(const std::vector<glm::vec3>& decoded, const std::vector<glm::vec3>& positions)
+{
+    if (decoded.size() != positions.size())
+        return false;
+    for (std::size_t i = 0; i < positions.size(); i++)
+    {
+        const glm::vec3 error = glm::abs(decoded[i] - positions[i]);
+        if (std::max(error.x, std::max(error.y, error.z)) > 0.51f * FlockStreamEncoder::default_quantum)
+            return false;
+    }
+    return true;
+}
+
+TEST_CASE("Flock stream deltas and keyframes rebuild the quantized positions")
+{
+    FlockStreamEncoder        encoder;
+    FlockStreamDecoder        decoder;
+    FlockSnapshot             snapshot;
+    std::vector<std::uint8_t> frame;
+
+    std::vector<glm::vec3>   positions  = random_positions(100, 5.f, 3);
+    std::vector<glm::vec3>   velocities = random_positions(100, 0.05f, 4);
+    const std::vector<Color> colors(100, Color(0.2f, 0.4f, 1.f));
+
+    CHECK_FALSE(encoder.add_step(positions, 1)); // The first step needs a keyframe
+    encoder.write_keyframe(colors, 5.f, false, frame);
+    REQUIRE(decode_frame(decoder, frame, snapshot));
+    CHECK(within_quantum(snapshot.positions, positions));
+    CHECK(snapshot.step == 1);
+    CHECK(glm::length(snapshot.colors[0] - colors[0]) < 1.f / 255.f);
+    const std::uint64_t population = snapshot.population;
+
+    bool deltas_exact = true;
+    for (std::uint64_t step = 2; step < 20; step++)
+    {
+        for (std::size_t i = 0; i < positions.size(); i++)
+        {
+            velocities[i] *= step % 5 == 0 ? -1.f : 1.f; // Turns, so that the prediction misses now and then
+            positions[i] += velocities[i];
+        }
+        REQUIRE(encoder.add_step(positions, step));
+        encoder.write_delta(5.f, false, frame);
+        deltas_exact &= decode_frame(decoder, frame, snapshot) && within_quantum(snapshot.positions, positions) && snapshot.step == step;
+    }
+    CHECK(deltas_exact);
+    CHECK(snapshot.population == population);
+
+    // Fewer boids, only a keyframe describes the step and a delta of it is refused
+    positions.resize(60);
+    CHECK_FALSE(encoder.add_step(positions, 20));
+    encoder.write_delta(5.f, false, frame);
+    CHECK_FALSE(decode_frame(decoder, frame, snapshot));
+    encoder.write_keyframe(colors, 5.f, false, frame);
+    REQUIRE(decode_frame(decoder, frame, snapshot));
+    CHECK(within_quantum(snapshot.positions, positions));
+    CHECK(snapshot.population != population);
+}
+
+TEST_CASE("Flock stream viewers that skipped frames resume at the next keyframe")
+{
+    FlockStreamEncoder        encoder;
+    FlockStreamDecoder        late_decoder;
+    FlockSnapshot             snapshot;
+    std::vector<std::uint8_t> frame;
+    std::vector<glm::vec3>    positions = random_positions(50, 5.f, 5);
+    const std::vector<Color>  colors(50, Color(1.f));
+
+    encoder.add_step(positions, 1);
+    encoder.write_keyframe(colors, 5.f, false, frame); // Skipped by the late viewer
+
+    positions[0] += glm::vec3(0.1f);
+    REQUIRE(encoder.add_step(positions, 2));
+    encoder.write_delta(5.f, false, frame);
+    CHECK_FALSE(decode_frame(late_decoder, frame, snapshot)); // No keyframe yet
+
+    positions[1] -= glm::vec3(0.2f);
+    REQUIRE(encoder.add_step(positions, 3));
+    encoder.write_keyframe(colors, 5.f, false, frame);
+    REQUIRE(decode_frame(late_decoder, frame, snapshot));
+    CHECK(within_quantum(snapshot.positions, positions));
+
+    positions[2] += glm::vec3(0.3f);
+    REQUIRE(encoder.add_step(positions, 4));
+    encoder.write_delta(5.f, false, frame);
+    REQUIRE(decode_frame(late_decoder, frame, snapshot));
+    CHECK(within_quantum(snapshot.positions, positions));
+
+    // A truncated frame is refused, and so are the deltas after it until a keyframe
+    encoder.add_step(positions, 5);
+    encoder.write_delta(5.f, false, frame);
+    frame.pop_back();
+    FlockStreamHeader header;
+    std::memcpy(&header, frame.data(), sizeof(header));
+    header.payload_bytes--;
+    CHECK_FALSE(late_decoder.decode(header, std::span<const std::uint8_t>(frame).subspan(sizeof(header)), snapshot));
+    encoder.add_step(positions, 6);
+    encoder.write_delta(5.f, false, frame);
+    CHECK_FALSE(decode_frame(late_decoder, frame, snapshot));
+}
+
+TEST_CASE("Flock stream headers are checked before their frame is allocated")
+{
+    FlockStreamEncoder        encoder;
+    std::vector<std::uint8_t> frame;
+    encoder.add_step(random_positions(20, 5.f, 6), 1);
+    encoder.write_keyframe({}, 5.f, false, frame);
+    FlockStreamHeader keyframe;
+    std::memcpy(&keyframe, frame.data(), sizeof(keyframe));
+    CHECK(flock_stream_header_error(keyframe) == nullptr);
+
+    FlockStreamHeader unknown = keyframe;
+    unknown.type              = static_cast<FlockStreamFrameType>(7);
+    CHECK(flock_stream_header_error(unknown) != nullptr);
+
+    // A few bytes cannot hold billions of boids, nor can the largest allowed flock need gigabytes
+    FlockStreamHeader huge = keyframe;
+    huge.boid_count        = 4'000'000'000u;
+    CHECK(flock_stream_header_error(huge) != nullptr);
+    huge.boid_count    = flock_stream_max_boids;
+    huge.payload_bytes = 4'000'000'000u;
+    CHECK(flock_stream_header_error(huge) != nullptr);
+
+    FlockStreamHeader short_delta = keyframe;
+    short_delta.type              = FlockStreamFrameType::Delta;
+    short_delta.payload_bytes     = 3 * 20 - 1;
+    CHECK(flock_stream_header_error(short_delta) != nullptr);
+    short_delta.payload_bytes = 3 * 20;
+    CHECK(flock_stream_header_error(short_delta) == nullptr);
+
+    // The decoder refuses them too, and waits for the next keyframe
+    FlockStreamDecoder decoder;
+    FlockSnapshot      snapshot;
+    REQUIRE(decode_frame(decoder, frame, snapshot));
+    CHECK_FALSE(decoder.decode(unknown, std::span<const std::uint8_t>(frame).subspan(sizeof(unknown)), snapshot));
+    CHECK(snapshot.positions.size() == 20);
+}
+
+// ---StreamingBuffer---
+
+TEST_CASE("StreamingBuffer regions are aligned powers of two that fit the frame")
+{
+    const std::size_t sizes[] = {1, 255, 256, 257, 1000, 4096, 70000};
+    for (const std::size_t size : sizes)
+    {
+        const std::size_t region_size = StreamingBuffer::region_size_for(size);
+        CHECK(region_size >= size);
+        CHECK(region_size % StreamingBuffer::region_alignment == 0);
+        CHECK(std::has_single_bit(region_size));
+        CHECK(region_size < 2 * std::max(size, StreamingBuffer::region_alignment));
+    }
+}
+
+TEST_CASE("StreamingBuffer frames rotate over every region before reusing one")
+{
+    // The region the persistent buffer starts at is written last, after region_count - 1 others
+    std::size_t              region = 0;
+    std::vector<std::size_t> written;
+    for (std::size_t frame = 0; frame < 2 * StreamingBuffer::region_count; frame++)
+    {
+        region = StreamingBuffer::next_region(region);
+        written.push_back(region);
+    }
+
+    // Any region_count frames in a row write distinct regions, so the GPU can read the previous ones meanwhile
+    bool distinct = true;
+    for (std::size_t first = 0; first + StreamingBuffer::region_count <= written.size(); first++)
+    {
+        std::vector<std::size_t> window(written.begin() + static_cast<std::ptrdiff_t>(first), written.begin() + static_cast<std::ptrdiff_t>(first + StreamingBuffer::region_count));
+        std::sort(window.begin(), window.end());
+        distinct &= std::adjacent_find(window.begin(), window.end()) == window.end() && window.back() < StreamingBuffer::region_count;
+    }
+    CHECK(distinct);
+    CHECK(written[StreamingBuffer::region_count - 1] == 0);
+    CHECK(written[StreamingBuffer::region_count] == written[0]);
+}
+
+// ---RenderQueue---
+
+// Submits the keys in order, then checks that the queue sorts them as a stable sort of the keys does
+static bool sorts_like_std(RenderQueue& queue, const std::vector<std::uint64_t>& keys)
+{
+    queue.clear();
+    for (const std::uint64_t key : keys)
+    {
+        queue.submit(key, {nullptr, nullptr, DrawKind::Object});
+    }
+    queue.sort();
+
+    std::vector<std::uint32_t> expected(keys.size());
+    for (std::size_t i = 0; i < keys.size(); i++)
+    {
+        expected[i] = static_cast<std::uint32_t>(i);
+    }
+    std::stable_sort(expected.begin(), expected.end(), [&](std::uint32_t a, std::uint32_t b) { return keys[a] < keys[b]; });
+    for (std::size_t i = 0; i < keys.size(); i++)
+    {
+        if (queue.get_sorted_item(i) != expected[i])
+            return false;
+    }
+    return true;
+}
+
+TEST_CASE("RenderQueue sorts keys as std::stable_sort does")
+{
+    RenderQueue                             queue;
+    std::mt19937_64                         random(47);
+    std::uniform_int_distribution<unsigned> small(0, 3);
+
+    std::vector<std::uint64_t> keys(3000);
+    std::generate(keys.begin(), keys.end(), [&]() { return random(); });
+    CHECK(sorts_like_std(queue, keys));
+
+    // Few distinct values in every field: ties, and digits shared by every key that the sort skips
+    for (std::uint64_t& key : keys)
+    {
+        key = RenderQueue::make_key(static_cast<RenderPass>(small(random) % 2), 1 + small(random), 7, small(random), static_cast<float>(small(random)));
+    }
+    CHECK(sorts_like_std(queue, keys));
+
+    CHECK(sorts_like_std(queue, std::vector<std::uint64_t>(5, 42)));
+    CHECK(sorts_like_std(queue, {}));
+}
+
+TEST_CASE("RenderQueue keys order by pass, program, mesh, texture then depth")
+{
+    const std::uint64_t key = RenderQueue::make_key(RenderPass::FrontFaces, 2, 3, 4, 10.f);
+    CHECK(RenderQueue::make_key(RenderPass::BackFaces, 9, 9, 9, 90.f) < key);
+    CHECK(RenderQueue::make_key(RenderPass::FrontFaces, 1, 9, 9, 90.f) < key);
+    CHECK(RenderQueue::make_key(RenderPass::FrontFaces, 2, 2, 9, 90.f) < key);
+    CHECK(RenderQueue::make_key(RenderPass::FrontFaces, 2, 3, 3, 90.f) < key);
+    CHECK(RenderQueue::make_key(RenderPass::FrontFaces, 2, 3, 4, 5.f) < key);
+
+    // Depths out of the camera range share its ends
+    CHECK(RenderQueue::make_key(RenderPass::FrontFaces, 2, 3, 4, -1.f) == RenderQueue::make_key(RenderPass::FrontFaces, 2, 3, 4, 0.f));
+    CHECK(RenderQueue::make_key(RenderPass::FrontFaces, 2, 3, 4, 1000.f) == RenderQueue::make_key(RenderPass::FrontFaces, 2, 3, 4, RenderQueue::max_depth));
+}
+
+// ---Mesh optimizer---
+
+// A side x side grid of quads, two triangles each, in a shuffled order. Vertices are their positions.
+static std::vector<std::uint32_t> shuffled_grid(std::uint32_t side, std::vector<float>& vertices)
+{
+    vertices.clear();
+    for (std::uint32_t y = 0; y <= side; y++)
+    {
+        for (std::uint32_t x = 0; x <= side; x++)
+        {
+            vertices.insert(vertices.end(), {static_cast<float>(x), static_cast<float>(y), 0.f});
+        }
+    }
+
+    std::vector<std::array<std::uint32_t, 3>> triangles;
+    for (std::uint32_t y = 0; y < side; y++)
+    {
+        for (std::uint32_t x = 0; x < side; x++)
+        {
+            const std::uint32_t corner = y * (side + 1) + x;
+            triangles.push_back({corner, corner + 1, corner + side + 1});
+            triangles.push_back({corner + 1, corner + side + 2, corner + side + 1});
+        }
+    }
+    std::shuffle(triangles.begin(), triangles.end(), std::mt19937(49));
+
+    std::vector<std::uint32_t> indices;
+    for (const auto& triangle : triangles)
+    {
+        indices.insert(indices.end(), triangle.begin(), triangle.end());
+    }
+    return indices;
+}
+
+// Corners of the triangles, each rotated to start at its smallest so that the winding is kept, then sorted
+static std::vector<std::array<glm::vec3, 3>> triangle_set(const std::vector<std::uint32_t>& indices, const std::vector<float>& vertices)
+{
+    std::vector<std::array<glm::vec3, 3>> triangles;
+    auto                                  corner = [&](std::uint32_t index) { return glm::vec3(vertices[3 * index], vertices[3 * index + 1], vertices[3 * index + 2]); };
+    auto                                  less   = [](const glm::vec3& a, const glm::vec3& b) { return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z); };
+    for (std::size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        std::array<glm::vec3, 3> triangle{corner(indices[i]), corner(indices[i + 1]), corner(indices[i + 2])};
+        std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end(), less), triangle.end());
+        triangles.push_back(triangle);
+    }
+    std::sort(triangles.begin(), triangles.end(), [&](const auto& a, const auto& b) {
+        return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), less);
+    });
+    return triangles;
+}
+
+TEST_CASE("optimize_vertex_cache keeps the triangles and lowers the ACMR")
+{
+    std::vector<float>         vertices;
+    std::vector<std::uint32_t> indices = shuffled_grid(40, vertices);
+    const auto                 before  = triangle_set(indices, vertices);
+    const float                acmr    = compute_acmr(indices);
+
+    optimize_vertex_cache(indices, vertices.size() / 3);
+    CHECK(triangle_set(indices, vertices) == before);
+    CHECK(compute_acmr(indices) < acmr);
+    CHECK(compute_acmr(indices) < 1.f);
+
+    // Overdraw reordering trades at most the allowed share of that
+    const float optimized = compute_acmr(indices);
+    optimize_overdraw(indices, vertices, 3, 1.05f);
+    CHECK(triangle_set(indices, vertices) == before);
+    CHECK(compute_acmr(indices) <= optimized * 1.05f + 1e-4f);
+}
+
+TEST_CASE("optimize_vertex_fetch orders the vertices by first use and drops unused ones")
+{
+    std::vector<float>         vertices;
+    std::vector<std::uint32_t> indices = shuffled_grid(10, vertices);
+    vertices.insert(vertices.end(), {-1.f, -1.f, -1.f}); // Used by no triangle
+    const auto before = triangle_set(indices, vertices);
+
+    optimize_vertex_fetch(vertices, 3, indices);
+    CHECK(triangle_set(indices, vertices) == before);
+    CHECK(vertices.size() == 3 * 11 * 11);
+
+    bool          in_order = true;
+    std::uint32_t next     = 0;
+    for (const std::uint32_t index : indices)
+    {
+        in_order &= index <= next;
+        next = std::max(next, index + 1);
+    }
+    CHECK(in_order);
+}
+
+// ---Vertex packing---
+
+struct UnpackedVertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 uv;
+};
+
+template<typename T>
+static T read_packed(const PackedVertices& packed, std::size_t offset)
+{
+    T value;
+    std::memcpy(&value, &packed.data[offset], sizeof(T));
+    return value;
+}
+
+// Decodes the i-th vertex of a compact format as 3D.vs.glsl does
+static UnpackedVertex unpack_vertex(const PackedVertices& packed, std::size_t i)
+{
+    const std::size_t stride = vertex_format_stride(packed.format);
+    const std::size_t vertex = i * stride;
+    const bool        wide   = packed.format == VertexFormat::Compact16;
+
+    UnpackedVertex unpacked;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        unpacked.position[axis] = packed.position_min[axis] + read_packed<std::uint16_t>(packed, vertex + 2 * axis) / 65535.f * packed.position_extent[axis];
+    }
+    const float u = (wide ? read_packed<std::int16_t>(packed, vertex + 8) : read_packed<std::int8_t>(packed, vertex + 6)) / packed.normal_scale;
+    const float v = (wide ? read_packed<std::int16_t>(packed, vertex + 10) : read_packed<std::int8_t>(packed, vertex + 7)) / packed.normal_scale;
+    glm::vec3   n(u, v, 1.f - std::abs(u) - std::abs(v));
+    const float t = std::max(-n.z, 0.f);
+    n.x += n.x >= 0.f ? -t : t;
+    n.y += n.y >= 0.f ? -t : t;
+    unpacked.normal = glm::normalize(n);
+    unpacked.uv     = glm::vec2(glm::unpackHalf1x16(read_packed<std::uint16_t>(packed, vertex + stride - 4)), glm::unpackHalf1x16(read_packed<std::uint16_t>(packed, vertex + stride - 2)));
+    return unpacked;
+}
+
+// Vertices of ModelLoader::vertex_stride floats, one per normal, with UVs that half floats hold exactly
+static std::vector<float> vertices_with_normals(const std::vector<glm::vec3>& normals)
+{
+    std::vector<float> vertices;
+    for (std::size_t i = 0; i < normals.size(); i++)
+    {
+        const glm::vec3 position = normals[i] * 3.f + glm::vec3(1.f, -2.f, 0.5f);
+        const glm::vec3 normal   = normals[i];
+        vertices.insert(vertices.end(), {position.x, position.y, position.z, normal.x, normal.y, normal.z, static_cast<float>(i % 8) / 8.f, 0.25f});
+    }
+    return vertices;
+}
+
+TEST_CASE("pack_vertices picks the smallest format within the tolerances")
+{
+    // Normals along the axes are exact with 8 bits
+    const std::vector<glm::vec3> axes = {{1.f, 0.f, 0.f}, {-1.f, 0.f, 0.f}, {0.f, 1.f, 0.f}, {0.f, -1.f, 0.f}, {0.f, 0.f, 1.f}, {0.f, 0.f, -1.f}};
+    const PackedVertices         flat = pack_vertices(vertices_with_normals(axes));
+    CHECK(flat.format == VertexFormat::Compact8);
+    CHECK(flat.data.size() == axes.size() * 12);
+
+    // Smooth normals need 16 bits
+    std::vector<glm::vec3> smooth = random_positions(500, 1.f, 50);
+    for (glm::vec3& normal : smooth)
+    {
+        normal = glm::normalize(normal);
+    }
+    const PackedVertices curved = pack_vertices(vertices_with_normals(smooth));
+    CHECK(curved.format == VertexFormat::Compact16);
+    CHECK(curved.data.size() == smooth.size() * 16);
+    CHECK(curved.max_normal_error_degrees <= normal_error_tolerance_degrees);
+
+    // Large UVs lose too much as half floats, the floats are kept as they are
+    std::vector<float>   tiled = vertices_with_normals(axes);
+    tiled[6]                   = 1000.3f;
+    const PackedVertices raw   = pack_vertices(tiled);
+    CHECK(raw.format == VertexFormat::Float);
+    REQUIRE(raw.data.size() == tiled.size() * sizeof(float));
+    CHECK(std::memcmp(raw.data.data(), tiled.data(), raw.data.size()) == 0);
+}
+
+TEST_CASE("pack_vertices round trips within the reported errors")
+{
+    std::vector<glm::vec3> normals = random_positions(500, 1.f, 51);
+    for (glm::vec3& normal : normals)
+    {
+        normal = glm::normalize(normal);
+    }
+    const std::vector<float> vertices = vertices_with_normals(normals);
+    const PackedVertices     packed   = pack_vertices(vertices);
+    REQUIRE(packed.format != VertexFormat::Float);
+
+    // Positions are 16-bit steps of the bounds, 6 units wide here
+    const float position_tolerance = 6.f / 65535.f;
+    bool        positions_close    = true;
+    bool        normals_close      = true;
+    bool        uvs_exact          = true;
+    for (std::size_t i = 0; i < normals.size(); i++)
+    {
+        const UnpackedVertex unpacked = unpack_vertex(packed, i);
+        const glm::vec3      position(vertices[i * 8], vertices[i * 8 + 1], vertices[i * 8 + 2]);
+        const glm::vec3      error = glm::abs(unpacked.position - position);
+        positions_close &= std::max(error.x, std::max(error.y, error.z)) <= position_tolerance;
+
+        const float angle = std::acos(std::clamp(glm::dot(unpacked.normal, normals[i]), -1.f, 1.f)) * 180.f / 3.14159265f;
+        normals_close &= angle <= packed.max_normal_error_degrees + 0.01f;
+        uvs_exact &= unpacked.uv.x == vertices[i * 8 + 6] && unpacked.uv.y == vertices[i * 8 + 7];
+    }
+    CHECK(positions_close);
+    CHECK(normals_close);
+    CHECK(uvs_exact);
+}
@@ -0,0 +1,220 @@
+// Example reader of the flock exported to shared memory, and latency benchmark of the export.
+//
+//   BoidsCube --shared-memory /boids              (or BoidsCube --headless 100000 2000 /boids)
+//   SharedFlockReader /boids                      prints the centroid and mean speed of the flock every second
+//   SharedFlockReader /boids --bench [seconds]    measures the delay between a step being published and being read
+//
+// Only shared_flock_layout.hpp is needed, and maths/percentile.hpp for the benchmark: the reader maps the object
+// read-only and never copies a whole step.
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "maths/percentile.hpp"
+#include "simulation/shared_flock_layout.hpp"
+
+using clock_type = std::chrono::steady_clock;
+
+static std::int64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now().time_since_epoch()).count();
+}
+
+// Waits up to 10 seconds for the simulation to create the object
+static const SharedFlockHeader* map_flock(const std::string& name)
+{
+    const auto deadline = clock_type::now() + std::chrono::seconds(10);
+    while (true)
+    {
+        const int descriptor = shm_open(name.c_str(), O_RDONLY, 0);
+        if (descriptor >= 0)
+        {
+            struct stat status {};
+            fstat(descriptor, &status);
+            if (static_cast<std::size_t>(status.st_size) >= sizeof(SharedFlockHeader))
+            {
+                void* memory = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_SHARED, descriptor, 0);
+                close(descriptor);
+                if (memory == MAP_FAILED)
+                {
+                    std::cerr << "Error: could not map shared memory " << name << ": " << std::strerror(errno) << std::endl;
+                    return nullptr;
+                }
+
+                const auto* header = static_cast<const SharedFlockHeader*>(memory);
+                if (header->magic == SharedFlockHeader::expected_magic && header->version == SharedFlockHeader::expected_version)
+                {
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    return header;
+                }
+                munmap(memory, static_cast<std::size_t>(status.st_size));
+            }
+            else
+            {
+                close(descriptor);
+            }
+        }
+
+        if (clock_type::now() > deadline)
+        {
+            std::cerr << "Error: no flock published to shared memory " << name << std::endl;
+            return nullptr;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+}
+
+// Maps the object that replaced header once the flock outgrew it. Returns false when there is none.
+static bool follow_replacement(const std::string& name, const SharedFlockHeader*& header)
+{
+    if (header->replaced.load(std::memory_order_acquire) == 0)
+        return true;
+    munmap(const_cast<SharedFlockHeader*>(header), shared_flock_bytes(header->slot_count, header->capacity));
+    header = map_flock(name);
+    if (header == nullptr)
+        return false;
+    std::cout << "Remapped " << name << ": " << header->slot_count << " slots of " << header->capacity << " boids" << std::endl;
+    return true;
+}
+
+// Reads the slot in place with visitor(slot), and retries if the writer touched it meanwhile.
+// Returns the number of retries.
+template<typename Visitor>
+static std::size_t read_slot(const SharedFlockSlot* slot, Visitor&& visitor)
+{
+    std::size_t retries = 0;
+    while (true)
+    {
+        const std::uint64_t before = slot->sequence.load(std::memory_order_acquire);
+        if ((before & 1) == 0)
+        {
+            visitor(*slot);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot->sequence.load(std::memory_order_relaxed) == before)
+                return retries;
+        }
+        retries++;
+    }
+}
+
+static const SharedFlockSlot* latest_slot(const SharedFlockHeader* header, std::uint64_t published)
+{
+    return shared_flock_slot(header, (published - 1) % header->slot_count);
+}
+
+static int print_flock(const std::string& name, const SharedFlockHeader* header)
+{
+    while (true)
+    {
+        if (!follow_replacement(name, header))
+            return EXIT_FAILURE;
+        const std::uint64_t published = header->published.load(std::memory_order_acquire);
+        if (published > 0)
+        {
+            std::uint64_t step = 0;
+            float         centroid[3]{};
+            float         speed_sum  = 0.f;
+            std::uint32_t boid_count = 0;
+            read_slot(latest_slot(header, published), [&](const SharedFlockSlot& slot) {
+                const float* positions  = shared_flock_positions(&slot);
+                const float* velocities = shared_flock_velocities(&slot, header->capacity);
+                step                    = slot.step;
+                boid_count              = std::min(slot.boid_count, header->capacity);
+                std::fill(std::begin(centroid), std::end(centroid), 0.f);
+                speed_sum = 0.f;
+                for (std::uint32_t i = 0; i < boid_count; i++)
+                {
+                    const float* velocity = velocities + 3 * i;
+                    for (int axis = 0; axis < 3; axis++)
+                    {
+                        centroid[axis] += positions[3 * i + axis];
+                    }
+                    speed_sum += std::sqrt(velocity[0] * velocity[0] + velocity[1] * velocity[1] + velocity[2] * velocity[2]);
+                }
+            });
+
+            const float scale = boid_count == 0 ? 0.f : 1.f / static_cast<float>(boid_count);
+            std::cout << "step " << step << ": " << boid_count << " boids, centroid (" << centroid[0] * scale << ", " << centroid[1] * scale << ", "
+                      << centroid[2] * scale << "), mean speed " << speed_sum * scale << std::endl;
+        }
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+}
+
+static double percentile(const std::vector<double>& sorted, double p)
+{
+    return sorted[percentile_index(sorted.size(), p)];
+}
+
+// Polls the header without sleeping so the measured delay is the one of the export, not of the reader's sleeps
+static int benchmark(const std::string& name, const SharedFlockHeader* header, double seconds)
+{
+    std::vector<double> latencies_us;
+    std::size_t         retries      = 0;
+    std::uint64_t       missed_steps = 0;
+    std::uint64_t       last_seen    = header->published.load(std::memory_order_acquire);
+
+    const auto end_time = clock_type::now() + std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(seconds));
+    while (clock_type::now() < end_time)
+    {
+        if (header->replaced.load(std::memory_order_relaxed) != 0)
+        {
+            // The new object counts its steps from 0
+            if (!follow_replacement(name, header))
+                return EXIT_FAILURE;
+            last_seen = header->published.load(std::memory_order_acquire);
+        }
+        const std::uint64_t published = header->published.load(std::memory_order_acquire);
+        if (published == last_seen)
+        {
+            // Leaves the core to the simulation on machines with few of them
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::int64_t publish_ns = 0;
+        retries += read_slot(latest_slot(header, published), [&](const SharedFlockSlot& slot) { publish_ns = slot.publish_ns; });
+        latencies_us.push_back(static_cast<double>(now_ns() - publish_ns) / 1000.);
+        missed_steps += published - last_seen - 1;
+        last_seen = published;
+    }
+
+    if (latencies_us.empty())
+    {
+        std::cerr << "Error: no step was published during the benchmark" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::sort(latencies_us.begin(), latencies_us.end());
+    std::cout << "steps read: " << latencies_us.size() << ", missed: " << missed_steps << ", seqlock retries: " << retries << '\n'
+              << "publish to read latency (us): p50 " << percentile(latencies_us, 50.) << ", p95 " << percentile(latencies_us, 95.)
+              << ", p99 " << percentile(latencies_us, 99.) << ", max " << latencies_us.back() << std::endl;
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <shared memory name> [--bench [seconds]]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const SharedFlockHeader* header = map_flock(argv[1]);
+    if (header == nullptr)
+        return EXIT_FAILURE;
+
+    std::cout << "Mapped " << argv[1] << ": " << header->slot_count << " slots of " << header->capacity << " boids" << std::endl;
+    if (argc > 2 && std::string(argv[2]) == "--bench")
+        return benchmark(argv[1], header, argc > 3 ? std::stod(argv[3]) : 5.);
+    return print_flock(argv[1], header);
+}